@@ -37,6 +37,7 @@ enum class MessageType : uint8_t {
     ERASE_PROGRAM            = 0x05,
     WRITE_PROGRAM_CRC        = 0x06,
     ERASE_USER_CONFIGURATION = 0x07,
+    ERASE_PAGE               = 0x08,
 
     // MODULE_NAME         = 0x25,
     // READ_MODULE_NAME    = 0x26,
@@ -45,12 +46,23 @@ enum class MessageType : uint8_t {
     DESCRIBE_V1         = 0x29,
     DESCRIBE_V2         = 0x26,
     DESCRIBE_V3         = 0x30,
+    DESCRIBE_ALL        = 0x31,
+    DESCRIPTION         = 0x32,
 
 	TAGS_READ           = 0x40,
+	TAGS_READ_BULK      = 0x41,
 
     IHEX_WRITE = 0x50,
     IHEX_READ  = 0x51,
 
+    BLOCK_BEGIN  = 0x52,
+    BLOCK_WRITE  = 0x53,
+    BLOCK_END    = 0x54,
+    BLOCK_STATUS = 0x55,
+    PAGE_CRC     = 0x56,
+
+    BLOCK_BEGIN_COMPRESSED = 0x57,
+
     RESET            = 0x60,
     RESET_ALL        = 0x61,
     BOOTLOAD         = 0x70,
@@ -231,6 +243,100 @@ struct IHex {
     Data string;
 };
 
+/*! \brief Binary program block
+ *
+ * Blocks are streamed with a sliding window: the master does not wait for the acknowledge of a block before sending the next ones.
+ * The slave acknowledges each block by its index (see BlockAck), ignoring the sequence id of the message.
+ * As a block carries its absolute address, the slave can program blocks received out of order, or twice.
+ *
+ * Blocks flagged NO_ACK are multicast to several selected slaves: they are not acknowledged,
+ * and the master asks each slave for the blocks it has received with BLOCK_STATUS (see BlockBitmap).
+ */
+struct Block {
+    static const std::size_t SIZE = 32;
+
+    enum Flags : uint8_t {
+        NO_ACK = 0x01
+    };
+
+    uint16_t index; //!< position of the block in the transfer
+    uint8_t  length; //!< valid bytes in data
+    uint8_t  flags;
+    uint32_t address; //!< absolute address of data[0]
+    uint8_t  data[SIZE];
+};
+
+struct BlockAck {
+    uint16_t index;
+};
+
+/*! \brief Blocks received by a slave
+ *
+ * Bit i (LSB first) is set if block first + i has been received and programmed.
+ */
+struct BlockBitmap {
+    static const std::size_t BITS = 320;
+
+    uint16_t first;
+    uint8_t  bits[BITS / 8];
+};
+
+/*! \brief CRC-32 (IEEE 802.3) of program flash pages
+ *
+ * count pages, starting from the one that holds the requested address. Pages are checked whole, erased bytes included.
+ */
+struct PageCRC {
+    static const std::size_t MAX_COUNT = 9;
+
+    uint32_t address; //!< address of the first page
+    uint16_t pageSize;
+    uint8_t  count;
+    uint8_t  reserved;
+    uint32_t crc[MAX_COUNT];
+};
+
+/*! \brief Compressed program transfer
+ *
+ * The blocks that follow carry an LZSS stream (see LzCodec), and their address is the offset in the stream.
+ * The slave decodes the stream in order: blocks that come after a missing one are dropped, and get sent again on their timeout.
+ * BLOCK_END is acknowledged once length bytes have been decoded and programmed from address on, and their CRC-32 matches crc.
+ */
+struct CompressedImage {
+    ModuleUID uid;
+    uint32_t  address;
+    uint32_t  length;
+    uint32_t  crc;
+};
+
+struct UIDAndRange {
+    ModuleUID uid;
+    uint16_t  offset;
+    uint16_t  length;
+};
+
+/*! \brief A piece of a bulk read
+ *
+ * A TAGS_READ_BULK request is answered by one acknowledge per Chunk::SIZE bytes of the range, all with the sequence id of the request + 1.
+ */
+struct Chunk {
+    static const std::size_t SIZE = 40;
+
+    uint16_t offset;
+    uint8_t  length;
+    uint8_t  reserved;
+    uint8_t  data[SIZE];
+};
+
+struct UIDAndIndex {
+    ModuleUID uid;
+    uint16_t  index;
+};
+
+struct UIDAndCount {
+    ModuleUID uid;
+    uint16_t  count;
+};
+
 struct Announce {
     ModuleUID uid;
     uint8_t   version;
@@ -264,6 +370,15 @@ struct DescribeV3 {
     ModuleType moduleType;
     ModuleName moduleName;
 };
+
+/*! \brief Answer of a slave to DESCRIBE_ALL
+ *
+ * All the slaves answer at once, whether selected or not: the reply is a DESCRIPTION message, not an acknowledge.
+ */
+struct Description {
+    ModuleUID  uid;
+    DescribeV3 description;
+};
 }
 
 namespace messages {
@@ -280,18 +395,31 @@ using DeselectSlave = Message_<BootMsg, MessageType::DESELECT_SLAVE, payload::UI
 
 using EraseConfiguration = Message_<BootMsg, MessageType::ERASE_CONFIGURATION, payload::UID>;
 using EraseProgram       = Message_<BootMsg, MessageType::ERASE_PROGRAM, payload::UID>;
+using ErasePage          = Message_<BootMsg, MessageType::ERASE_PAGE, payload::UIDAndAddress>;
 using WriteProgramCrc    = Message_<BootMsg, MessageType::WRITE_PROGRAM_CRC, payload::UIDAndCRC>;
 
 using DescribeV1 = Message_<BootMsg, MessageType::DESCRIBE_V1, payload::UID>;
 using DescribeV2 = Message_<BootMsg, MessageType::DESCRIBE_V2, payload::UID>;
 using DescribeV3 = Message_<BootMsg, MessageType::DESCRIBE_V3, payload::UID>;
 
-using TagsRead = Message_<BootMsg, MessageType::TAGS_READ, payload::UIDAndAddress>;
+using DescribeAll = Message_<BootMsg, MessageType::DESCRIBE_ALL, payload::EMPTY>;
+using Description = Message_<BootMsg, MessageType::DESCRIPTION, payload::Description>;
+
+using TagsRead     = Message_<BootMsg, MessageType::TAGS_READ, payload::UIDAndAddress>;
+using TagsReadBulk = Message_<BootMsg, MessageType::TAGS_READ_BULK, payload::UIDAndRange>;
 
 using IHexData = Message_<BootMsg, MessageType::IHEX_READ, payload::IHex>;
 
 using IHexRead = Message_<BootMsg, MessageType::IHEX_WRITE, payload::UIDAndAddress>;
 
+using BlockBegin  = Message_<BootMsg, MessageType::BLOCK_BEGIN, payload::UID>;
+using BlockWrite  = Message_<BootMsg, MessageType::BLOCK_WRITE, payload::Block>;
+using BlockEnd    = Message_<BootMsg, MessageType::BLOCK_END, payload::UIDAndCount>;
+using BlockStatus = Message_<BootMsg, MessageType::BLOCK_STATUS, payload::UIDAndIndex>;
+using PageCRCRead = Message_<BootMsg, MessageType::PAGE_CRC, payload::UIDAndAddress>;
+
+using BlockBeginCompressed = Message_<BootMsg, MessageType::BLOCK_BEGIN_COMPRESSED, payload::CompressedImage>;
+
 using Reset = Message_<BootMsg, MessageType::RESET, payload::UID>;
 using ResetAll = Message_<BootMsg, MessageType::RESET_ALL, payload::EMPTY>;
 
@@ -306,5 +434,9 @@ using AcknowledgeDescribeV1 = AcknowledgeMessage_<AcknowledgeMsg, payload::Descr
 using AcknowledgeDescribeV2 = AcknowledgeMessage_<AcknowledgeMsg, payload::DescribeV2>;
 using AcknowledgeDescribeV3 = AcknowledgeMessage_<AcknowledgeMsg, payload::DescribeV3>;
 using AcknowledgeString   = AcknowledgeMessage_<AcknowledgeMsg, char[44]>;
+using AcknowledgeBlock    = AcknowledgeMessage_<AcknowledgeMsg, payload::BlockAck>;
+using AcknowledgeBlockBitmap = AcknowledgeMessage_<AcknowledgeMsg, payload::BlockBitmap>;
+using AcknowledgePageCRC  = AcknowledgeMessage_<AcknowledgeMsg, payload::PageCRC>;
+using AcknowledgeChunk    = AcknowledgeMessage_<AcknowledgeMsg, payload::Chunk>;
 }
 NAMESPACE_CORE_MW_END
@@ -7,12 +7,48 @@
 #include <core/mw/Middleware.hpp>
 #include <core/os/Thread.hpp>
 #include <core/mw/BootMsg.hpp>
+#include <core/mw/LzCodec.hpp>
 #include <algorithm>
+#include <type_traits>
 
 #ifndef MAX_NUMBER_OF_SLAVES
 #define MAX_NUMBER_OF_SLAVES 32
 #endif
 
+//! Program blocks in flight, waiting for their acknowledge
+#ifndef BOOTLOADER_MASTER_WINDOW
+#define BOOTLOADER_MASTER_WINDOW 8
+#endif
+
+#ifndef BOOTLOADER_MASTER_BLOCK_TIMEOUT_MS
+#define BOOTLOADER_MASTER_BLOCK_TIMEOUT_MS 250
+#endif
+
+#ifndef BOOTLOADER_MASTER_BLOCK_RETRIES
+#define BOOTLOADER_MASTER_BLOCK_RETRIES 5
+#endif
+
+//! Pause after each BOOTLOADER_MASTER_WINDOW multicast blocks, as there are no acks to pace the transfer
+#ifndef BOOTLOADER_MASTER_MULTICAST_GAP_MS
+#define BOOTLOADER_MASTER_MULTICAST_GAP_MS 5
+#endif
+
+//! How long to collect the answers to DESCRIBE_ALL
+#ifndef BOOTLOADER_MASTER_DESCRIBE_ALL_MS
+#define BOOTLOADER_MASTER_DESCRIBE_ALL_MS 500
+#endif
+
+//! Also publish the commands to the local subscribers, for slaves running on the same middleware (e.g.: simulated ones)
+#ifndef BOOTLOADER_MASTER_LOCAL_SLAVES
+#define BOOTLOADER_MASTER_LOCAL_SLAVES 0
+#endif
+
+//! Incoming messages queue: a window of acks, or the answers of all the slaves to DESCRIBE_ALL (and the window of blocks itself, with local slaves)
+#ifndef BOOTLOADER_MASTER_QUEUE_LENGTH
+#define BOOTLOADER_MASTER_QUEUE_LENGTH (((MAX_NUMBER_OF_SLAVES > BOOTLOADER_MASTER_WINDOW + 2) ? MAX_NUMBER_OF_SLAVES : (BOOTLOADER_MASTER_WINDOW + 2)) \
+                                        + (BOOTLOADER_MASTER_LOCAL_SLAVES ? BOOTLOADER_MASTER_WINDOW : 0))
+#endif
+
 NAMESPACE_CORE_MW_BEGIN
 
 namespace bootloader {
@@ -24,7 +60,7 @@ struct SlaveDescription {
 		NONE, V1, V2, V3
 	};
 
-	SlaveDescription() : _version(Version::NONE) {}
+	SlaveDescription() : _version(Version::NONE), _announced_version(0), _described(false), _bulk_tags(true) {}
 
 	Version version() const;
 
@@ -36,6 +72,9 @@ struct SlaveDescription {
 
 private:
 	Version _version;
+	uint8_t _announced_version; //!< protocol version from the announce, a hint for ls()
+	bool    _described; //!< described by the last ls()
+	bool    _bulk_tags; //!< false once the slave has refused, or ignored, TAGS_READ_BULK
 	union {
 		payload::DescribeV1 _v1;
 		payload::DescribeV2 _v2;
@@ -45,45 +84,101 @@ private:
 
 /* Static size associative map.
  *
- * Warning: naive implementation.
+ * Entries are kept in insertion order, so that they can be enumerated by index.
+ * Keys are looked up through an open addressing (linear probing) table of entry indices, twice as large as N.
+ * Entries cannot be removed, but the map can be cleared.
  */
+constexpr std::size_t
+static_hash_map_capacity(
+    std::size_t n,
+    std::size_t p = 1
+)
+{
+    return (p >= 2 * n) ? p : static_hash_map_capacity(n, 2 * p);
+}
+
 template <typename KEY, typename VALUE, std::size_t N>
-class StaticMap
+class StaticHashMap
 {
+    static_assert(std::is_integral<KEY>::value, "Keys must be integers");
+    static_assert(N < 0xFFFF, "Too many entries");
+
 private:
     struct Entry {
         KEY   key;
         VALUE value;
     };
 
+    // Smallest power of 2 that is at least 2 * N: probe sequences stay short, and wrap with a mask
+    static const std::size_t CAPACITY = static_hash_map_capacity(N);
+    static const uint16_t    EMPTY    = 0xFFFF;
+
     core::Array<Entry, N> _data;
-    std::size_t           _cnt;
+    uint16_t    _index[CAPACITY];
+    std::size_t _cnt;
+
+    static std::size_t
+    hash(
+        const KEY& key
+    )
+    {
+        // Fibonacci hashing: UIDs are not evenly distributed in their low bits
+        return (static_cast<uint32_t>(key) * 2654435761u) >> 16;
+    }
+
+    /* Slot of the key, or the empty slot where it would go.
+     */
+    std::size_t
+    slot(
+        const KEY& key
+    ) const
+    {
+        std::size_t i = hash(key) & (CAPACITY - 1);
+
+        while ((_index[i] != EMPTY) && !(_data[_index[i]].key == key)) {
+            i = (i + 1) & (CAPACITY - 1);
+        }
+
+        return i;
+    }
+
+    void
+    reindex()
+    {
+        for (uint16_t& i : _index) {
+            i = EMPTY;
+        }
+
+        for (std::size_t i = 0; i < _cnt; i++) {
+            _index[slot(_data[i].key)] = static_cast<uint16_t>(i);
+        }
+    }
 
 public:
-    StaticMap() : _cnt(0) {}
+    StaticHashMap() : _cnt(0)
+    {
+        reindex();
+    }
 
     VALUE&
     operator[](
         const KEY& key
     )
     {
-        std::size_t i;
-
-        // Search the key
-        for (i = 0; i < _cnt; i++) {
-            if (_data[i].key == key) {
-            	// We already have an entry.
-                return _data[i].value;
-            }
+        std::size_t s = slot(key);
+
+        if (_index[s] != EMPTY) {
+            // We already have an entry.
+            return _data[_index[s]].value;
         }
 
         // No matches. Add a new entry.
-        if (i < N) {
-            _cnt++;
-            _data[i].key   = key;
-            _data[i].value = VALUE();
+        if (_cnt < N) {
+            _index[s] = static_cast<uint16_t>(_cnt);
+            _data[_cnt].key   = key;
+            _data[_cnt].value = VALUE();
 
-            return _data[i].value;
+            return _data[_cnt++].value;
         } else {
             CORE_ASSERT(!"Too many entries");
         }
@@ -91,23 +186,26 @@ public:
         UNREACHABLE;
     } // []
 
-/*
-    const VALUE&
-    operator[](
+    const VALUE*
+    find(
         const KEY& key
     ) const
     {
-        std::size_t i;
+        std::size_t s = slot(key);
 
-        for (i = 0; i < _cnt; i++) {
-            if (_data[i].key == key) {
-                return _data[i].value;
-            }
-        }
+        return (_index[s] != EMPTY) ? &_data[_index[s]].value : nullptr;
+    }
 
-        CORE_ASSERT(!"Element not found");
+    VALUE*
+    find(
+        const KEY& key
+    )
+    {
+        std::size_t s = slot(key);
+
+        return (_index[s] != EMPTY) ? &_data[_index[s]].value : nullptr;
     }
-*/
+
     const KEY&
     key(
         std::size_t i
@@ -135,16 +233,6 @@ public:
         return _data[i].value;
     }
 
-/*
-    Entry&
-    entry(
-        std::size_t i
-    )
-    {
-        CORE_ASSERT(i < _cnt);
-        return _data[i];
-    }
-*/
     std::size_t
     size() const
     {
@@ -165,18 +253,36 @@ public:
         }
 
     	_cnt = 0;
+
+    	reindex();
     }
 
     void sort() {
-    	std::sort(_data.begin(), _data.end(), [](const Entry& a,const Entry& b) {
+    	std::sort(_data.begin(), _data.begin() + _cnt, [](const Entry& a,const Entry& b) {
     		return a.key < b.key;
     	});
+
+    	reindex();
     }
 };
 
 class BootloaderMaster
 {
 public:
+    /*! \brief Transfer statistics
+     *
+     * Counted since the last resetStatistics(), to measure the throughput of a transfer mode on a given bus.
+     */
+    struct Statistics {
+        uint32_t       commands; //!< commands published
+        uint32_t       timeouts; //!< commands not acknowledged in time
+        uint32_t       blocks;   //!< blocks published, including the ones sent again
+        uint32_t       resent;   //!< blocks sent again (lost, not acknowledged in time, or missing from a group slave)
+        uint32_t       bytes;    //!< program bytes transferred, once (compressed bytes for compressed transfers)
+        core::os::Time start;    //!< time of resetStatistics()
+        core::os::Time last;     //!< time of the last acknowledge received
+    };
+
     BootloaderMaster();
 
     bool
@@ -185,6 +291,12 @@ public:
     bool
     stop();
 
+    /*! \brief Describe all the announced slaves
+     *
+     * First, all the slaves are asked to describe themselves at once (DESCRIBE_ALL).
+     * Those that do not answer are then selected and described one at a time, starting from the protocol version
+     * they have been described with before, or the one they announce.
+     */
     bool
     ls();
 
@@ -256,6 +368,115 @@ public:
     bool
     endIHex();
 
+    /*! \brief Begin a binary program transfer
+     *
+     * The program is streamed in payload::Block, with up to BOOTLOADER_MASTER_WINDOW blocks waiting for their acknowledge.
+     * Blocks that are not acknowledged in time are sent again, up to BOOTLOADER_MASTER_BLOCK_RETRIES times.
+     *
+     * \retval false the slave does not support binary transfers: use beginIHex()
+     */
+    bool
+    beginProgram();
+
+    /*! \brief Write an Intel HEX record
+     *
+     * The record is parsed here, and its data is packed into blocks.
+     */
+    bool
+    writeProgram(
+        const char* ihex_string
+    );
+
+    bool
+    writeProgram(
+        uint32_t       address,
+        const uint8_t* data,
+        std::size_t    length
+    );
+
+    /*! \brief Program only the flash pages that differ from the image
+     *
+     * The CRC of each page the image spans is read from the slave, and compared to the one of the image
+     * (with the bytes of the page not covered by the image as erased).
+     * Pages that differ are erased and written; the others are left alone. Pages beyond the image are not erased.
+     *
+     * \note Opens and closes its own binary transfer: do not call eraseProgram(), beginProgram() or endProgram().
+     */
+    bool
+    writeProgramDiff(
+        uint32_t       address,
+        const uint8_t* image,
+        std::size_t    length,
+        std::size_t*   changed = nullptr //!< [out] number of pages written, or nullptr
+    );
+
+    /*! \brief Program an image, sending it compressed
+     *
+     * The image is LZSS encoded as it is streamed; the slave decodes it, and checks the CRC of what it has programmed.
+     *
+     * \pre The program has been erased (see eraseProgram()).
+     * \note Opens and closes its own binary transfer: do not call beginProgram() or endProgram().
+     */
+    bool
+    writeProgramCompressed(
+        uint32_t       address,
+        const uint8_t* image,
+        std::size_t    length,
+        LzEncoder&     encoder, //!< [in] the encoder to use (it is large: this way it can be shared, or allocated only when needed)
+        std::size_t*   compressed = nullptr //!< [out] compressed length, or nullptr
+    );
+
+    /*! \brief End a binary program transfer
+     *
+     * Waits for all the blocks to be acknowledged.
+     */
+    bool
+    endProgram();
+
+    /*! \brief Select several slaves of the same module type at once
+     *
+     * Slaves that do not answer are left out of the group.
+     *
+     * \retval false the slaves are not all of the same module type (see ls()), or some have not been selected
+     */
+    bool
+    selectGroup(
+        const ModuleUID* uids,
+        std::size_t      count
+    );
+
+    /*! \brief Program the same image into all the slaves of the group
+     *
+     * Blocks are published once for the whole group. Then, each slave reports the blocks it has received,
+     * and its missing ones are published again, up to BOOTLOADER_MASTER_BLOCK_RETRIES rounds in a row.
+     *
+     * \retval true all the slaves of the group have been programmed (see groupSlaveOk())
+     */
+    bool
+    writeGroupProgram(
+        uint32_t       address,
+        const uint8_t* image,
+        std::size_t    length
+    );
+
+    std::size_t
+    groupSize() const;
+
+    ModuleUID
+    groupSlaveID(
+        std::size_t i
+    ) const;
+
+    bool
+    groupSlaveOk(
+        std::size_t i
+    ) const;
+
+    /*! \brief Read all the tags of the selected slave
+     *
+     * Tags are read in bulk (TAGS_READ_BULK), BOOTLOADER_MASTER_WINDOW chunks per request, or 16 bytes per command
+     * from slaves that do not support it.
+     */
     bool
 	readTags(char* buffer);
 
@@ -298,6 +519,15 @@ public:
     std::size_t
     slavesCount() const;
 
+    void
+    resetStatistics();
+
+    const Statistics&
+    statistics() const
+    {
+        return _statistics;
+    }
+
 
     ModuleUID
     slaveID(
@@ -328,11 +558,11 @@ private:
     void
     masterNodeCode();
 
-    StaticMap<ModuleUID, SlaveDescription, MAX_NUMBER_OF_SLAVES> _slaves;
+    StaticHashMap<ModuleUID, SlaveDescription, MAX_NUMBER_OF_SLAVES> _slaves;
 
     core::mw::Node _node;
     core::mw::Publisher<BootMsg>     _pub;
-    core::mw::Subscriber<BootMsg, 2> _sub;
+    core::mw::Subscriber<BootMsg, BOOTLOADER_MASTER_QUEUE_LENGTH> _sub;
 
     core::os::Thread* _masterAdvertiseThread;
     core::os::Thread* _masterAnnounceThread;
@@ -346,14 +576,133 @@ private:
     BootMsg*       _command;
     AcknowledgeMsg _last_ack;
     ModuleUID      _selected;
+    Statistics     _statistics;
 
     core::os::Thread* _runner;
 
+    struct WindowSlot {
+        enum class State : uint8_t {
+            FREE, PENDING, NACKED
+        };
+
+        payload::Block block;
+        core::os::Time sent;
+        uint8_t        retries;
+        volatile State state;
+    };
+
+    WindowSlot        _window[BOOTLOADER_MASTER_WINDOW];
+    volatile bool     _window_event;
+    core::os::Thread* _window_runner;
+    payload::Block _staging;
+    uint16_t       _blocks;
+    uint32_t       _ihex_base;
+
+    struct GroupMember {
+        ModuleUID uid;
+        bool      ok;
+    };
+
+    GroupMember _group[MAX_NUMBER_OF_SLAVES];
+    std::size_t _group_size;
+
+    uint8_t*                   _bulk_buffer;
+    uint32_t                   _bulk_offset;
+    uint32_t                   _bulk_length;
+    volatile uint32_t          _bulk_received; //!< one bit per chunk
+    volatile AcknowledgeStatus _bulk_status;
+
+    static_assert(BOOTLOADER_MASTER_WINDOW <= 32, "A bulk read window is tracked by a 32 bit mask");
+
+    void
+    acknowledgeChunk(
+        const AcknowledgeMsg& ack
+    );
+
+    void
+    description(
+        const BootMsg& msg
+    );
+
+    bool
+    describeAll(
+        core::os::Time timeout
+    );
+
+    bool
+    describe(
+        SlaveDescription& slave
+    );
+
+    bool
+    readTagsBulk(
+        char*    buffer,
+        uint32_t size
+    );
+
+    void
+    disableBulkTags();
+
+    const SlaveDescription*
+    findSlave(
+        ModuleUID uid
+    ) const;
+
+    bool
+    readPageCRC(
+        uint32_t          address,
+        payload::PageCRC& crcs
+    );
+
+    bool
+    readBlockBitmap(
+        uint16_t              first,
+        payload::BlockBitmap& bitmap
+    );
+
+    static void
+    makeBlock(
+        payload::Block& block,
+        uint16_t        index,
+        uint32_t        address,
+        const uint8_t*  image,
+        std::size_t     length
+    );
+
     bool
     wait(
         core::os::Time timeout
     );
 
+    void
+    acknowledgeBlock(
+        const AcknowledgeMsg& ack
+    );
+
+    void
+    waitForBlockAck(
+        core::os::Time timeout
+    );
+
+    bool
+    sendBlock(
+        const payload::Block& block
+    );
+
+    bool
+    serviceWindow(
+        core::os::Time& timeout
+    );
+
+    void
+    resetTransfer();
+
+    bool
+    queueBlock();
+
+    bool
+    drainWindow();
+
     void
     wake();
 
@@ -375,6 +724,12 @@ private:
     bool
     endCommand();
 
+    //! Publish to the slaves (see BOOTLOADER_MASTER_LOCAL_SLAVES)
+    bool
+    publish(
+        BootMsg& msg
+    );
+
     bool
     waitForAck(
         core::os::Time timeout = core::os::Time::s(5)
@@ -440,6 +795,29 @@ private:
         ModuleUID   uid,
         uint32_t    address
     );
+
+    bool
+    commandCompressedImage(
+        MessageType type,
+        ModuleUID   uid,
+        uint32_t    address,
+        uint32_t    length,
+        uint32_t    crc
+    );
+
+    bool
+    commandUIDAndIndex(
+        MessageType type,
+        ModuleUID   uid,
+        uint16_t    index
+    );
+
+    bool
+    commandUIDAndCount(
+        MessageType type,
+        ModuleUID   uid,
+        uint16_t    count
+    );
 };
 }
 NAMESPACE_CORE_MW_END
@@ -9,6 +9,10 @@
 #include <core/mw/namespace.hpp>
 #include <core/common.hpp>
 
+#if !defined(CORE_CRC32_SLICE_BY_8) || defined(__DOXYGEN__)
+#define CORE_CRC32_SLICE_BY_8 1
+#endif
+
 NAMESPACE_CORE_MW_BEGIN
 
 
@@ -321,4 +325,133 @@ Checksummer::compute_checksum()
     return static_cast<uint8_t>(Static<value>::CHECKSUM);
 }
 
+
+/*! \brief CRC-32 (IEEE 802.3, as in zlib)
+ *
+ * Table driven. With CORE_CRC32_SLICE_BY_8, 8 bytes are processed per step (8 KiB of tables),
+ * otherwise 1 byte per step (1 KiB of table).
+ */
+class CRC32:
+    private core::Uncopyable
+{
+private:
+    static const std::size_t SLICES = CORE_CRC32_SLICE_BY_8 ? 8 : 1;
+    static const uint32_t    TABLE[SLICES][256];
+
+    uint32_t crc;
+
+public:
+    uint32_t
+    get() const;
+
+    void
+    reset();
+
+    void
+    add(
+        const uint8_t value
+    );
+
+    void
+    add(
+        const uint8_t* chunkp,
+        size_t         length
+    );
+
+    void
+    add(
+        const void* chunkp,
+        size_t      length
+    );
+
+    /*! \brief Add length bytes of the same value (e.g.: erased flash)
+     */
+    void
+    fill(
+        const uint8_t value,
+        size_t        length
+    );
+
+    operator uint32_t() const;
+
+    CRC32();
+    CRC32(
+        const void* chunkp,
+        size_t      length
+    );
+
+    static uint32_t
+    compute(
+        const void* chunkp,
+        size_t      length
+    );
+};
+
+
+inline
+uint32_t
+CRC32::get() const
+{
+    return ~crc;
+}
+
+inline
+void
+CRC32::reset()
+{
+    crc = 0xFFFFFFFF;
+}
+
+inline
+void
+CRC32::add(
+    const uint8_t value
+)
+{
+    crc = (crc >> 8) ^ TABLE[0][(crc ^ value) & 0xFF];
+}
+
+inline
+void
+CRC32::add(
+    const void* chunkp,
+    size_t      length
+)
+{
+    add(reinterpret_cast<const uint8_t*>(chunkp), length);
+}
+
+inline
+CRC32::operator uint32_t() const
+{
+    return get();
+}
+
+inline
+CRC32::CRC32()
+    :
+    crc(0xFFFFFFFF)
+{}
+
+inline
+CRC32::CRC32(
+    const void* chunkp,
+    size_t      length
+)
+    :
+    crc(0xFFFFFFFF)
+{
+    add(chunkp, length);
+}
+
+inline
+uint32_t
+CRC32::compute(
+    const void* chunkp,
+    size_t      length
+)
+{
+    return CRC32(chunkp, length).get();
+}
+
 NAMESPACE_CORE_MW_END
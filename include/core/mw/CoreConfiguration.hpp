@@ -12,6 +12,10 @@
 #include <core/String.hpp>
 #include <core/mw/StaticList.hpp>
 #include <core/mw/NamingTraits.hpp>
+#include <core/os/Mutex.hpp>
+#include <core/os/ScopedLock.hpp>
+#include <core/os/Thread.hpp>
+#include <core/os/Time.hpp>
 
 #include <initializer_list>
 #include <type_traits>
@@ -47,6 +51,38 @@ struct CoreConfigurationMap {
     //! Type of the map key
     using Key = core::String<16>;
 
+    //! Type of the key hash
+    using Hash = uint32_t;
+
+    /*! \brief Hash of a key (FNV-1a)
+     *
+     * It is constexpr, so that the hash of a literal key can be computed at compile time.
+     */
+    static constexpr Hash
+    hash(
+        const char* key, //!< [in] key
+        std::size_t n = Key::SIZE, //!< [in] maximum length of the key
+        Hash        h = 2166136261u //!< [in] FNV offset basis
+    )
+    {
+        return ((n == 0) || (*key == '\0')) ? h : hash(key + 1, n - 1, (h ^ static_cast<uint8_t>(*key)) * 16777619u);
+    }
+
+    /*! \brief A key, together with its hash
+     *
+     * \see CORE_CONFIGURATION_KEY
+     */
+    struct HashedKey {
+        constexpr explicit
+        HashedKey(
+            const char* key,
+            Hash        hash
+        ) : key(key), hash(hash) {}
+
+        const char* key;
+        Hash        hash;
+    };
+
     /*! \brief Metadata about a configuration field
      *
      */
@@ -96,6 +132,32 @@ struct CoreConfigurationMap {
     ) const;
 
 
+    /*! \brief Get index of the field given its hashed key
+     *
+     * \return index of the field in the map
+
+     * \note If the field does not exist, it returns an invalid index
+     */
+    const std::size_t
+    getFieldIndex(
+        const HashedKey& key //!< [in] name of the field, and its hash
+    ) const
+    {
+        return findField(key.hash, key.key);
+    }
+
+
+    /*! \brief Find a field given the hash of its key
+     *
+     * \return index of the field in the map, or getSize() if the field does not exist
+     */
+    virtual std::size_t
+    findField(
+        Hash        hash, //!< [in] hash of the key
+        const char* key //!< [in] key
+    ) const = 0;
+
+
     using iterator = const FieldMetadata *;
 
     virtual iterator
@@ -141,10 +203,89 @@ struct CoreConfigurationMap_:
         return _map.end();
     }
 
+    std::size_t
+    findField(
+        Hash        hash,
+        const char* key
+    ) const
+    {
+        if (!_index.ready) {
+            buildIndex();
+        }
+
+        // Binary search for the first entry with the given hash
+        std::size_t lo = 0;
+        std::size_t hi = LENGTH;
+
+        while (lo < hi) {
+            std::size_t mid = lo + (hi - lo) / 2;
+
+            if (_index.hashes[mid] < hash) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+
+        // Collisions are possible, but very unlikely: check the keys
+        for (std::size_t i = lo; (i < LENGTH) && (_index.hashes[i] == hash); i++) {
+            std::size_t field = _index.fields[i];
+
+            if (strncmp(_map.at(field).key.c_str(), key, Key::SIZE) == 0) {
+                return field;
+            }
+        }
+
+        return LENGTH;
+    } // findField
+
 private:
     static const core::Array<FieldMetadata, LENGTH> _map;
+
+    //! Fields sorted by the hash of their key
+    struct Index {
+        bool        ready;
+        Hash        hashes[LENGTH];
+        std::size_t fields[LENGTH];
+    };
+
+    static Index _index;
+
+    static void
+    buildIndex()
+    {
+        Index tmp;
+
+        // Insertion sort, the maps are small
+        for (std::size_t i = 0; i < LENGTH; i++) {
+            Hash        h = hash(_map.at(i).key.c_str());
+            std::size_t j = i;
+
+            while ((j > 0) && (tmp.hashes[j - 1] > h)) {
+                tmp.hashes[j] = tmp.hashes[j - 1];
+                tmp.fields[j] = tmp.fields[j - 1];
+                j--;
+            }
+
+            tmp.hashes[j] = h;
+            tmp.fields[j] = i;
+        }
+
+        tmp.ready = true;
+
+        core::os::SysLock::acquire();
+
+        if (!_index.ready) {
+            _index = tmp;
+        }
+
+        core::os::SysLock::release();
+    } // buildIndex
 };
 
+template <class C>
+typename CoreConfigurationMap_<C>::Index CoreConfigurationMap_<C>::_index;
+
 /*! \brief CoreConfigurationStatic_
  *
  */
@@ -248,12 +389,15 @@ struct CoreConfiguration {
 
     /*! \brief Get a configuration field
      *
-     * This is specialized for strings. It pads the string x with \\0.
+     * This is specialized for strings. The whole field is copied, \\0 padding included:
+     * a string that fills the whole field is not terminated.
+     *
+     * \pre x must hold at least the size of the field.
      */
     virtual void
     get(
         CoreConfigurationMap::Key key, //!< [in] key (== name) of the field
-        char*                     x//!< [in/out] string
+        char*                     x//!< [out] string
     ) const = 0;
 };
 
@@ -265,6 +409,28 @@ struct CoreConfiguration_:
     public C,
     public CoreConfiguration,
     private CoreConfigurationStatic_ {
+    /*! \brief Set all the fields at once
+     *
+     * It is a single copy of the whole struct, instead of a lookup and a copy per field.
+     */
+    void
+    setAll(
+        const typename C::Type& x
+    )
+    {
+        memcpy(static_cast<typename C::Type*>(this), &x, sizeof(typename C::Type));
+    }
+
+    /*! \brief Get all the fields at once
+     */
+    void
+    getAll(
+        typename C::Type& x
+    ) const
+    {
+        memcpy(&x, static_cast<const typename C::Type*>(this), sizeof(typename C::Type));
+    }
+
     void
     setAt(
         std::size_t i,
@@ -345,6 +511,44 @@ struct CoreConfiguration_:
         setAt(this->getFieldIndex(key), x);
     }
 
+    void
+    set(
+        const CoreConfigurationMap::HashedKey& key,
+        const void*                            x
+    )
+    {
+        setAt(this->getFieldIndex(key), x);
+    }
+
+    template <typename T>
+    void
+    set(
+        const CoreConfigurationMap::HashedKey& key,
+        const T&                               x
+    )
+    {
+        setAt(this->getFieldIndex(key), x);
+    }
+
+    template <typename T>
+    void
+    set(
+        const CoreConfigurationMap::HashedKey& key,
+        const std::initializer_list<T>&        x
+    )
+    {
+        setAt(this->getFieldIndex(key), x);
+    }
+
+    void
+    set(
+        const CoreConfigurationMap::HashedKey& key,
+        const char*                            x
+    )
+    {
+        setAt(this->getFieldIndex(key), x);
+    }
+
     void
     getAt(
         std::size_t i,
@@ -403,6 +607,34 @@ struct CoreConfiguration_:
     {
         getAt(this->getFieldIndex(key), x);
     }
+
+    void
+    get(
+        const CoreConfigurationMap::HashedKey& key,
+        void*                                  x
+    ) const
+    {
+        getAt(this->getFieldIndex(key), x);
+    }
+
+    template <typename T>
+    void
+    get(
+        const CoreConfigurationMap::HashedKey& key,
+        T&                                     x
+    ) const
+    {
+        getAt(this->getFieldIndex(key), x);
+    }
+
+    void
+    get(
+        const CoreConfigurationMap::HashedKey& key,
+        char*                                  x
+    ) const
+    {
+        getAt(this->getFieldIndex(key), x);
+    }
 }
 
 CORE_PACKED_ALIGNED;
@@ -602,7 +834,10 @@ public:
      */
     CoreConfigurable(
         const char* key
-    ) : CoreConfigurableBase::CoreConfigurableBase(key), _overriding(nullptr) {}
+    ) : CoreConfigurableBase::CoreConfigurableBase(key), _overriding(nullptr), _snapshots(), _updating(nullptr), _retired(nullptr), _retiredAt(), _gracePeriod(core::os::Time::ms(100))
+    {
+        _updateLock.initialize();
+    }
 
     /*! \brief Set the configuration
      *
@@ -619,6 +854,10 @@ public:
 
     /*! \brief Get the current configuration
      *
+     * It is lock free: the configuration is only ever replaced by swapping the pointer (see beginUpdate()).
+     *
+     * \note When the configuration is updated with beginUpdate()/commitUpdate(), the returned reference must not be held
+     * for longer than the grace period: re-read it (e.g.: once per onLoop).
      */
     inline const ConfigurationType&
     configuration() const
@@ -626,6 +865,83 @@ public:
         return *(reinterpret_cast<const ConfigurationType*>(_configuration));
     }
 
+//--- CONFIGURATION UPDATE ----------------------------------------------------
+/*! \brief Begin a configuration update
+ *
+ * A new configuration is prepared off to the side, as a copy of the current one (if any), while readers keep using the current one.
+ * Updates are serialized: the caller holds the update until commitUpdate().
+ * If the spare snapshot was retired less than a grace period ago, the caller waits for the grace period to expire.
+ *
+ * \return the new configuration, to be modified and then published with commitUpdate()
+ */
+    CoreConfigurationType&
+    beginUpdate()
+    {
+        _updateLock.acquire();
+
+        // Use the snapshot that is not published
+        std::size_t i = (_configuration == static_cast<CoreConfigurationBase*>(_snapshots[0])) ? 1 : 0;
+
+        if (_snapshots[i] == nullptr) {
+            _snapshots[i] = new CoreConfigurationType(); // It will live forever!!!
+        }
+
+        CORE_ASSERT(_snapshots[i] != nullptr);
+
+        if (_snapshots[i] == _retired) {
+            // Readers may still be using it...
+            core::os::Time elapsed = core::os::Time::now() - _retiredAt;
+
+            if (elapsed < _gracePeriod) {
+                core::os::Thread::sleep(_gracePeriod - elapsed);
+            }
+
+            _retired = nullptr;
+        }
+
+        if (_configuration != nullptr) {
+            memcpy(static_cast<CoreConfigurationBase*>(_snapshots[i]), _configuration, getConfigurationSize());
+        }
+
+        _updating = _snapshots[i];
+
+        return *_updating;
+    } // beginUpdate
+
+    /*! \brief Publish the configuration prepared with beginUpdate()
+     *
+     * The configuration is published with a single pointer swap. The previous snapshot is reclaimed after the grace period.
+     */
+    void
+    commitUpdate()
+    {
+        CORE_ASSERT(_updating != nullptr);
+
+        if ((_configuration == static_cast<CoreConfigurationBase*>(_snapshots[0])) || (_configuration == static_cast<CoreConfigurationBase*>(_snapshots[1]))) {
+            _retired   = static_cast<CoreConfigurationType*>(const_cast<CoreConfigurationBase*>(_configuration));
+            _retiredAt = core::os::Time::now();
+        }
+
+        setConfigurationBase(*_updating);
+        _updating = nullptr;
+
+        _updateLock.release();
+    } // commitUpdate
+
+    /*! \brief Set the grace period
+     *
+     * It must be longer than the longest time a reader holds a reference returned by configuration().
+     */
+    void
+    setGracePeriod(
+        core::os::Time gracePeriod
+    )
+    {
+        _gracePeriod = gracePeriod;
+    }
+
+//-----------------------------------------------------------------------------
+
     /*! \brief Create an overriding configuration
      *
      * It allocates (if required) a CoreConfigurationType struct, and copies the current configuration (if any).
@@ -693,7 +1009,16 @@ public:
     isOverridingConfiguration()
     {
         if(_overriding != nullptr) {
-            return _overriding == _configuration;
+            if (_overriding == _configuration) {
+                return true;
+            }
+        }
+
+        // A published snapshot overrides the stored configuration, too
+        for (const CoreConfigurationType* snapshot : _snapshots) {
+            if ((snapshot != nullptr) && (static_cast<const CoreConfigurationBase*>(snapshot) == _configuration)) {
+                return true;
+            }
         }
 
         return false;
@@ -734,6 +1059,12 @@ public:
 
 private:
     CoreConfigurationType* _overriding;
+    CoreConfigurationType* _snapshots[2];
+    CoreConfigurationType* _updating;
+    CoreConfigurationType* _retired;
+    core::os::Time         _retiredAt;
+    core::os::Time         _gracePeriod;
+    core::os::Mutex        _updateLock;
 };
 
 // --------------------------------------------------------------------------------------------------------------------
@@ -754,12 +1085,8 @@ CoreConfigurationStatic_::set(
 
     CORE_ASSERT(s1 == s2 && t1 == t2);  // make sure we are doing something meaningful...
 
-    const T* src = reinterpret_cast<const T*>(&x);
-    T*       dst = reinterpret_cast<T*>(obj + field.offset);
-
-    while (s1--) {
-        *dst++ = *src++;
-    }
+    // The size is known at compile time: the compiler can turn it into word moves. The field may be unaligned, as configurations are packed.
+    memcpy(reinterpret_cast<uint8_t*>(obj + field.offset), &x, sizeof(T));
 }
 
 template <typename T>
@@ -777,11 +1104,8 @@ CoreConfigurationStatic_::set(
 
     CORE_ASSERT(s1 == s2 && t1 == t2);  // make sure we are doing something meaningful...
 
-    T* dst = reinterpret_cast<T*>(obj + field.offset);
-
-    for (T tmp : x) {
-        *dst++ = tmp;
-    }
+    // The elements of an initializer_list are contiguous
+    memcpy(reinterpret_cast<uint8_t*>(obj + field.offset), x.begin(), s2 * sizeof(T));
 }
 
 template <typename T>
@@ -799,12 +1123,7 @@ CoreConfigurationStatic_::get(
 
     CORE_ASSERT(s1 == s2 && t1 == t2);    // make sure we are doing something meaningful...
 
-    const T* src = reinterpret_cast<const T*>(obj + field.offset);
-    T*       dst = reinterpret_cast<T*>(&x);
-
-    while (s1--) {
-        *dst++ = *src++;
-    }
+    memcpy(&x, reinterpret_cast<const uint8_t*>(obj + field.offset), sizeof(T));
 }
 
 NAMESPACE_CORE_MW_END
@@ -812,6 +1131,9 @@ NAMESPACE_CORE_MW_END
 // --------------------------------------------------------------------------------------------------------------------
 // Macros that allow us to keep the python code generator clean
 // --------------------------------------------------------------------------------------------------------------------
+//! A key whose hash is computed at compile time, i.e.: configuration.set(CORE_CONFIGURATION_KEY("gain"), 1.0f)
+#define CORE_CONFIGURATION_KEY(__key__) \
+    core::mw::CoreConfigurationMap::HashedKey(__key__, std::integral_constant<core::mw::CoreConfigurationMap::Hash, core::mw::CoreConfigurationMap::hash(__key__)>::value)
 #define CORE_CONFIGURATION_BEGIN(__name__) \
     class __name__: \
         public core::mw::CoreConfigurationBase { \
@@ -13,6 +13,10 @@
 
 #include <type_traits>
 
+#if !defined(CORE_CONFIGURATION_INDEX_LENGTH) || defined(__DOXYGEN__)
+#define CORE_CONFIGURATION_INDEX_LENGTH 64
+#endif
+
 NAMESPACE_CORE_MW_BEGIN
 class CoreConfigurationStorage
 {
@@ -60,11 +64,54 @@ public:
     {
         return false;
     }
+
+    // Log-structured storage support. A storage that can erase a part of itself can be used as an append-only log.
+
+    /*! \brief Size of the smallest erasable unit
+     *
+     * \return the erase unit size, or 0 if partial erase is not supported
+     */
+    virtual std::size_t
+    eraseSize()
+    {
+        return 0;
+    }
+
+    /*! \brief Erase the unit starting at address
+     */
+    virtual bool
+    erase(
+        std::size_t address
+    )
+    {
+        return false;
+    }
+
+    /*! \brief Begin a write, without erasing anything
+     */
+    virtual bool
+    beginProgram()
+    {
+        return false;
+    }
+
+    virtual bool
+    endProgram()
+    {
+        return false;
+    }
 };
 
 class CoreConfigurationManager
 {
 public:
+    /*! \brief Adds a configurable object
+     *
+     * The object is also indexed by the hash of its key, so that loading a configuration is linear in the stored size.
+     * If more than CORE_CONFIGURATION_INDEX_LENGTH / 2 objects are added, the others are looked up linearly.
+     *
+     * \pre The key of the object must not change after it has been added.
+     */
     void
     add(
         const CoreConfigurableBase& configurableObject
@@ -78,24 +125,65 @@ public:
         C&  configuration
     );
 
+    /*! \brief Set the configurations from an image (see dumpTo())
+     *
+     * The configurations point into the image. Overridden configurations keep their overriding values.
+     */
     void
     setFrom(
         uint8_t*    storage,
         std::size_t size
     );
 
-    void
+    /*! \brief Check that setFrom() would apply a whole image
+     *
+     * \retval false the image holds blocks of unknown objects, or of objects whose configuration is overridden
+     * (setFrom() would skip them), or it is corrupted
+     */
+    bool
+    canSetFrom(
+        const uint8_t* storage,
+        std::size_t    size
+    );
+
+    /*! \brief Dump all the configurations to memory
+     *
+     * \pre size >= dumpSize()
+     *
+     * \return the number of bytes written
+     */
+    std::size_t
     dumpTo(
         uint8_t*    storage,
         std::size_t size
     );
 
+    /*! \brief Size of the image written by dumpTo()
+     */
+    std::size_t
+    dumpSize() const;
+
     void
     loadFrom(
         CoreConfigurationStorage& storage
     );
 
-    void
+    /*! \brief Save the configurations
+     *
+     * If the storage supports partial erase (see CoreConfigurationStorage::eraseSize()), and it holds at least two erase units,
+     * it is used as an append-only log, split in two banks:
+     * only the configurations that changed are appended, as new records.
+     * When a bank is full, the newest records are compacted into the other bank, which then becomes the active one.
+     * Records and banks are only considered valid once their commit markers have been written,
+     * so that an interrupted write leaves the previous configuration in place.
+     *
+     * Otherwise the whole storage is erased and rewritten.
+     *
+     * The configurations are then loaded back from the storage.
+     *
+     * \return success
+     */
+    bool
     saveTo(
         CoreConfigurationStorage& storage
     );
@@ -108,6 +196,127 @@ public:
 
 private:
     core::mw::StaticList<CoreConfigurableBase> _objects;
+
+    static_assert((CORE_CONFIGURATION_INDEX_LENGTH & (CORE_CONFIGURATION_INDEX_LENGTH - 1)) == 0, "CORE_CONFIGURATION_INDEX_LENGTH must be a power of 2");
+
+    //! Objects, by the hash of their key (open addressing, linear probing)
+    struct IndexEntry {
+        CoreConfigurationMap::Hash hash;
+        CoreConfigurableBase*      object;
+    };
+
+    IndexEntry  _index[CORE_CONFIGURATION_INDEX_LENGTH];
+    std::size_t _indexed;
+    bool        _overflow;
+
+    /*! \brief Sets the configuration block at storage + offset to the matching object
+     *
+     * \post In case of success, offset contains the offset to the first byte after the block, otherwise it is unchanged
+     *
+     * \retval true an object has taken the block
+     */
+    bool
+    setConfigurationFrom(
+        const uint8_t* storage,
+        std::size_t&   offset,
+        std::size_t    size
+    );
+
+    //! The object a key belongs to, nullptr if none
+    CoreConfigurableBase*
+    findObject(
+        const char* key
+    );
+
+    /*! \brief Walk the blocks of an image (see dumpTo())
+     *
+     * \retval false the length is not known: the image holds blocks of unknown objects, or it is corrupted.
+     * If writable is set, also when a block belongs to an object whose configuration is overridden.
+     */
+    bool
+    checkImage(
+        const uint8_t* image, //!< [in] the image
+        std::size_t    size, //!< [in] size of the memory that holds the image
+        std::size_t&   length, //!< [out] length of the image
+        bool           writable //!< [in] fail on overridden configurations
+    );
+
+    //! Log bank header
+    struct LogHeader {
+        uint32_t magic;
+        uint32_t sequence;
+    };
+
+    //! Log record header, followed by key, signature and data (the same layout of a dumpTo() block)
+    struct LogRecord {
+        uint32_t commit;
+        uint32_t size;
+    };
+
+    static const uint32_t LOG_MAGIC  = 0x474F4C43; // "CLOG"
+    static const uint32_t LOG_COMMIT = 0x0000C0DE;
+    static const uint32_t ERASED     = 0xFFFFFFFF;
+
+    static bool
+    isLog(
+        CoreConfigurationStorage& storage
+    );
+
+    static std::size_t
+    bankSize(
+        CoreConfigurationStorage& storage
+    );
+
+    static bool
+    activeBank(
+        CoreConfigurationStorage& storage,
+        std::size_t&              bank,
+        uint32_t&                 sequence
+    );
+
+    static bool
+    scanLog(
+        CoreConfigurationStorage& storage,
+        std::size_t               bank,
+        std::size_t&              end
+    );
+
+    static const uint8_t*
+    findRecord(
+        CoreConfigurationStorage&   storage,
+        std::size_t                 bank,
+        const CoreConfigurableBase& object
+    );
+
+    static std::size_t
+    recordSize(
+        const CoreConfigurableBase& object
+    );
+
+    static bool
+    appendRecord(
+        CoreConfigurationStorage&   storage,
+        std::size_t                 offset,
+        const CoreConfigurableBase& object
+    );
+
+    void
+    loadLog(
+        CoreConfigurationStorage& storage,
+        std::size_t               bank
+    );
+
+    bool
+    saveLog(
+        CoreConfigurationStorage& storage
+    );
+
+    bool
+    compactLog(
+        CoreConfigurationStorage& storage,
+        std::size_t               from,
+        uint32_t                  sequence
+    );
 };
 
 
@@ -0,0 +1,254 @@
+/* COPYRIGHT (c) 2016-2018 Nova Labs SRL
+ *
+ * All rights reserved. All use of this software and documentation is
+ * subject to the License Agreement located in the file LICENSE.
+ */
+
+#pragma once
+
+#include <core/mw/namespace.hpp>
+#include <core/common.hpp>
+
+#include <core/mw/CoreConfigurationManager.hpp>
+#include <core/mw/RPC.hpp>
+
+#include <type_traits>
+
+#if !defined(CORE_CONFIGURATION_TRANSFER_WINDOW) || defined(__DOXYGEN__)
+#define CORE_CONFIGURATION_TRANSFER_WINDOW 4
+#endif
+
+#if !defined(CORE_CONFIGURATION_TRANSFER_RETRIES) || defined(__DOXYGEN__)
+#define CORE_CONFIGURATION_TRANSFER_RETRIES 3
+#endif
+
+NAMESPACE_CORE_MW_BEGIN
+
+/*! \brief Remote configuration transfer protocol
+ *
+ * The whole configuration image of a module (see CoreConfigurationManager::dumpTo()) is moved in chunks over RPC.
+ * A transfer is opened by a BEGIN_* command, that returns a transfer id to be used by all the following commands.
+ *
+ * - BEGIN_READ: the server dumps its configurations. The response carries the image size (offset) and CRC.
+ * - BEGIN_WRITE: the client is going to write a whole image of the given size (offset).
+ * - BEGIN_DELTA: as BEGIN_WRITE, but the server starts from its current image, that must match the size (offset) and CRC given by the client.
+ * Only the chunks that differ are then written.
+ * - READ, WRITE: a chunk at offset.
+ * - COMMIT: the image is checked against the CRC, then applied with CoreConfigurationManager::setFrom(), and saved.
+ * It is rejected if it would not be applied as a whole (see CoreConfigurationManager::canSetFrom()).
+ * - ABORT: the transfer is dropped.
+ */
+struct CoreConfigurationTransfer {
+    static const std::size_t CHUNK_SIZE = 28;
+
+    enum class Command : uint8_t {
+        BEGIN_READ  = 0x01,
+        BEGIN_WRITE = 0x02,
+        BEGIN_DELTA = 0x03,
+        READ        = 0x10,
+        WRITE       = 0x11,
+        COMMIT      = 0x20,
+        ABORT       = 0x21
+    };
+
+    enum class Status : uint8_t {
+        OK            = 0x00,
+        BAD_STATE     = 0x01,
+        OUT_OF_RANGE  = 0x02,
+        CRC_MISMATCH  = 0x03,
+        BASE_MISMATCH = 0x04,
+        REJECTED      = 0x05, //!< Overridden (or unknown) configurations: nothing has been applied
+        STORAGE_ERROR = 0x06, //!< Applied, but not saved
+        NONE          = 0xFF
+    };
+
+    struct Request {
+        Command  command;
+        uint8_t  length;
+        uint16_t transfer;
+        uint32_t offset;
+        union {
+            uint8_t  data[CHUNK_SIZE];
+            uint32_t crc;
+        };
+    }
+
+    CORE_PACKED;
+
+    struct Response {
+        Status   status;
+        uint8_t  length;
+        uint16_t transfer;
+        uint32_t offset;
+        union {
+            uint8_t  data[CHUNK_SIZE];
+            uint32_t crc;
+        };
+    }
+
+    CORE_PACKED;
+
+    using Service = rpc::Service_<Request, Response>;
+
+    /*! \brief CRC-32 (IEEE 802.3) of an image
+     */
+    static uint32_t
+    crc(
+        const uint8_t* data,
+        std::size_t    length
+    );
+};
+
+/*! \brief Serves the configurations of a CoreConfigurationManager
+ *
+ * The image is staged in a buffer provided by the user, that must be at least CoreConfigurationManager::dumpSize() bytes.
+ *
+ * Configurations point into the memory they are set from. On COMMIT, the image is saved to storage, and the
+ * configurations are loaded back from it (see CoreConfigurationManager::saveTo()): they never point into the
+ * staging buffer, that the next transfer overwrites.
+ *
+ * Saving erases and programs the storage: the server is pooled, so that it runs on a RPC worker
+ * instead of stalling the RPC dispatcher. Start the workers with RPC::startWorkers().
+ *
+ * \pre storage must be a working storage (i.e.: storage.size() != 0).
+ */
+class CoreConfigurationTransferServer:
+    private core::Uncopyable
+{
+public:
+    CoreConfigurationTransferServer(
+        const char*               rpc_name,
+        CoreConfigurationManager& manager,
+        CoreConfigurationStorage& storage,
+        uint8_t*                  buffer,
+        std::size_t               size
+    );
+
+    bool
+    start(
+        rpc::RPC& rpc
+    );
+
+    bool
+    stop();
+
+private:
+    enum class State {
+        NONE, READING, WRITING
+    };
+
+    void
+    serve(
+        const CoreConfigurationTransfer::Request& request,
+        CoreConfigurationTransfer::Response&      response
+    );
+
+    rpc::Server<CoreConfigurationTransfer::Service> _server;
+    CoreConfigurationManager& _manager;
+    CoreConfigurationStorage& _storage;
+    rpc::RPC*   _rpc;
+    uint8_t*    _buffer;
+    std::size_t _size;
+    std::size_t _length;
+    State       _state;
+    uint16_t    _transfer;
+};
+
+/*! \brief Reads and writes the configurations of a remote module
+ *
+ * Up to CORE_CONFIGURATION_TRANSFER_WINDOW chunk requests are kept in flight, each by its own asynchronous client.
+ * A chunk that is not answered in time is requested again, up to CORE_CONFIGURATION_TRANSFER_RETRIES times.
+ */
+class CoreConfigurationTransferClient:
+    private core::Uncopyable
+{
+public:
+    CoreConfigurationTransferClient(
+        const char*    rpc_name,
+        core::os::Time timeout = core::os::Time::ms(500)
+    );
+
+    ~CoreConfigurationTransferClient();
+
+    bool
+    open(
+        rpc::RPC& rpc
+    );
+
+    bool
+    close();
+
+    /*! \brief Read the remote configuration image
+     *
+     * \return success
+     * \retval true the image has been read, and its CRC checked
+     */
+    bool
+    read(
+        uint8_t*     image, //!< [out] the image
+        std::size_t  size, //!< [in] size of image
+        std::size_t& length //!< [out] length of the image
+    );
+
+    /*! \brief Write and apply a whole configuration image
+     */
+    bool
+    write(
+        const uint8_t* image,
+        std::size_t    length
+    );
+
+    /*! \brief Write and apply a configuration image, sending only the chunks that differ from base
+     *
+     * base must be the image the remote module currently holds (e.g.: the result of a previous read()).
+     * If it is not, the whole image is written.
+     */
+    bool
+    write(
+        const uint8_t* image,
+        const uint8_t* base,
+        std::size_t    length
+    );
+
+private:
+    using Client = rpc::Client<CoreConfigurationTransfer::Service>;
+
+    struct Slot {
+        CoreConfigurationTransfer::Service service;
+        core::os::Time start;
+        uint8_t        retries;
+        bool           pending;
+        volatile bool  done;
+    };
+
+    Client&
+    client(
+        std::size_t i
+    );
+
+    bool
+    control(
+        CoreConfigurationTransfer::Command command,
+        uint32_t                           offset,
+        uint32_t                           crc
+    );
+
+    bool
+    stream(
+        CoreConfigurationTransfer::Command command,
+        const uint8_t*                     source, //!< [in] image to be written, or nullptr
+        const uint8_t*                     base, //!< [in] chunks equal to base are skipped, or nullptr
+        uint8_t*                           destination, //!< [out] image to be read, or nullptr
+        std::size_t                        length
+    );
+
+    rpc::RPC* _rpc;
+    Client    _control;
+    CoreConfigurationTransfer::Service _service;
+    std::aligned_storage<sizeof(Client), alignof(Client)>::type _clients[CORE_CONFIGURATION_TRANSFER_WINDOW];
+    Slot           _slots[CORE_CONFIGURATION_TRANSFER_WINDOW];
+    uint16_t       _transfer;
+    core::os::Time _timeout;
+};
+
+NAMESPACE_CORE_MW_END
@@ -14,9 +14,16 @@
 #include <core/mw/Node.hpp>
 
 #include <core/mw/ICoreNode.hpp>
+#include <core/mw/CoreNodeBarrier.hpp>
+
+#if !defined(CORE_NODE_MAX_DEPENDENCIES) || defined(__DOXYGEN__)
+#define CORE_NODE_MAX_DEPENDENCIES 4
+#endif
 
 NAMESPACE_CORE_MW_BEGIN
 
+class CoreNodeManager;
+
 /*! \brief Base class for all managed nodes
  *
  * Each node is a thread.
@@ -27,8 +34,25 @@ NAMESPACE_CORE_MW_BEGIN
 class CoreNode:
     public ICoreNode
 {
+    friend class CoreNodeManager;
+
+public:
+    /*! \brief Loop statistics
+     *
+     * Times are in us. The jitter is how late an iteration started, wrt its deadline.
+     * Without a loop period the loop is not timed: only the iterations are counted.
+     */
+    struct LoopStats {
+        uint32_t iterations;
+        uint32_t overruns; //!< iterations that did not complete within the loop period
+        uint32_t execution_last; //!< [us]
+        uint32_t execution_max; //!< [us]
+        uint32_t jitter_max; //!< [us]
+    };
+
 public:
-    virtual ~CoreNode() {}
+    virtual
+    ~CoreNode();
 
     /*! \brief Constructor
      *
@@ -67,6 +91,9 @@ public:
      *
      * The caller is suspended until the node is down (i.e.: the thread is finished)
      *
+     * When called by the node thread itself, the thread only stops: it is joined, and its working area handed back,
+     * by the next teardown() called from another thread, or by the destructor.
+     *
      * \post The node is in State::NONE state
      *
      * \return succes, and as it cannot fail, it always return true.
@@ -94,6 +121,46 @@ public:
     state() const;
 
 
+    /*! \brief Declare a prerequisite
+     *
+     * The CoreNodeManager brings node to each state of run() before this node, and stop() stops this node before node.
+     * Nodes that do not depend on each other go through their transitions concurrently.
+     *
+     * \pre node must be managed by the same CoreNodeManager
+     *
+     * \retval true the dependency has been added
+     * \retval false there are already CORE_NODE_MAX_DEPENDENCIES dependencies
+     */
+    bool
+    dependsOn(
+        const CoreNode& node //!< [in] the prerequisite
+    );
+
+
+    /*! \brief Set the loop period
+     *
+     * In the State::LOOPING state, onLoop() is called once per period, at absolute deadlines, so that the rate does not drift.
+     * If an iteration takes longer than the period, the missed deadlines are skipped, and counted as overruns.
+     * With core::os::Time::IMMEDIATE (the default), onLoop() is called back to back.
+     */
+    void
+    setLoopPeriod(
+        core::os::Time period //!< [in] loop period
+    );
+
+    core::os::Time
+    loopPeriod() const;
+
+
+    /*! \brief Loop statistics
+     */
+    const LoopStats&
+    loopStats() const;
+
+    void
+    resetLoopStats();
+
+
     /*! \brief Name of the node
      *
      * \return name of the node
@@ -192,9 +259,30 @@ private:
     core::os::Condition _condition;
 
     bool _mustRun;
-    bool _mustLoop;
+    volatile bool _mustLoop; //!< cleared by execute(Action::STOP), from another thread
     bool _mustTeardown;
 
+    core::os::Time _loopPeriod;
+    LoopStats      _loopStats;
+
+    CoreNodeBarrier* _barrier; //!< barrier to arrive at, when _barrierTarget is reached
+    State _barrierTarget;
+
+    const CoreNode* _dependencies[CORE_NODE_MAX_DEPENDENCIES];
+    std::size_t     _numDependencies;
+    bool            _dispatched; //!< the manager has already executed the current action
+
+    /*! \brief Arrive at barrier when target (or State::ERROR) is reached
+     */
+    void
+    arm(
+        CoreNodeBarrier& barrier,
+        State            target
+    );
+
+    void
+    disarm();
+
     void
     _doInitialize();
 
@@ -235,6 +323,32 @@ CoreNode::mustLoop()
     return _mustLoop;
 }
 
+inline void
+CoreNode::setLoopPeriod(
+    core::os::Time period
+)
+{
+    _loopPeriod = period;
+}
+
+inline core::os::Time
+CoreNode::loopPeriod() const
+{
+    return _loopPeriod;
+}
+
+inline const CoreNode::LoopStats&
+CoreNode::loopStats() const
+{
+    return _loopStats;
+}
+
+inline void
+CoreNode::resetLoopStats()
+{
+    _loopStats = LoopStats();
+}
+
 template <typename MT>
 inline bool
 CoreNode::advertise(
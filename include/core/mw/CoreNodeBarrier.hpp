@@ -0,0 +1,105 @@
+/* COPYRIGHT (c) 2016-2018 Nova Labs SRL
+ *
+ * All rights reserved. All use of this software and documentation is
+ * subject to the License Agreement located in the file LICENSE.
+ */
+
+#pragma once
+
+#include <core/mw/namespace.hpp>
+#include <core/common.hpp>
+
+#include <core/os/OS.hpp>
+#include <core/os/Thread.hpp>
+#include <core/os/Time.hpp>
+
+NAMESPACE_CORE_MW_BEGIN
+
+/*! \brief Counting barrier for CoreNode state transitions
+ *
+ * Nodes arrive at the barrier when they reach the target state of a transition (or fail).
+ * A single thread (i.e.: the CoreNodeManager) can wait for a given number of arrivals, without polling.
+ */
+class CoreNodeBarrier
+{
+public:
+    CoreNodeBarrier() : _arrived(0), _expected(0), _error(false), _waiter(nullptr) {}
+
+    /*! \brief Reset the barrier, for a new transition
+     */
+    void
+    reset()
+    {
+        core::os::SysLock::Scope lock;
+
+        _arrived  = 0;
+        _expected = 0;
+        _error    = false;
+        _waiter   = nullptr;
+    }
+
+    /*! \brief A node has completed its transition
+     *
+     * \pre Called with the system lock held
+     */
+    void
+    arrive_unsafe(
+        bool error //!< [in] the node has failed
+    )
+    {
+        _arrived++;
+        _error |= error;
+
+        if ((_waiter != nullptr) && ((_arrived >= _expected) || _error)) {
+            core::os::Thread::wake(*_waiter, WOKEN);
+            _waiter = nullptr;
+        }
+    }
+
+    /*! \brief Wait until at least count nodes have arrived, or one has failed
+     *
+     * \retval true count nodes have arrived, and none has failed
+     * \retval false timeout, or a node has failed
+     */
+    bool
+    wait(
+        std::size_t    count,
+        core::os::Time timeout = core::os::Time::INFINITE
+    )
+    {
+        core::os::SysLock::Scope lock;
+
+        if ((_arrived < count) && !_error) {
+            _expected = count;
+            _waiter   = &core::os::Thread::self();
+
+            core::os::Thread::sleep_timeout(timeout);
+
+            _waiter = nullptr;
+        }
+
+        return (_arrived >= count) && !_error;
+    }
+
+    std::size_t
+    arrived() const
+    {
+        return _arrived;
+    }
+
+    bool
+    failed() const
+    {
+        return _error;
+    }
+
+private:
+    static const core::os::Thread::Return WOKEN = 0x0BA221E2;
+
+    volatile std::size_t _arrived;
+    std::size_t          _expected;
+    volatile bool        _error;
+    core::os::Thread*    _waiter;
+};
+
+NAMESPACE_CORE_MW_END
@@ -10,12 +10,16 @@
 
 #include <core/mw/StaticList.hpp>
 #include <core/mw/CoreNode.hpp>
+#include <core/mw/CoreNodeBarrier.hpp>
 
 NAMESPACE_CORE_MW_BEGIN
 
 /*! \brief CoreNode manager.
  *
  * Manages CoreNode objects, syncronizing their states.
+ *
+ * Each transition is executed concurrently on all the nodes, then the manager sleeps on a barrier until all of them have reached
+ * the target state (or one has failed). Nodes that depend on others (see CoreNode::dependsOn()) wait only for their prerequisites.
  */
 class CoreNodeManager
 {
@@ -84,13 +88,33 @@ public:
     areOk();
 
 
+    /*! \brief Set the timeout of each transition
+     *
+     * If a transition is not completed within the timeout, run() and stop() fail. It is core::os::Time::INFINITE by default.
+     */
+    void
+    setTimeout(
+        core::os::Time timeout
+    );
+
+
 private:
     core::mw::StaticList<CoreNode> _nodes;
+    CoreNodeBarrier _barrier;
+    core::os::Time  _timeout;
 
     bool
     syncronize(
         ICoreNode::Action action,
-        ICoreNode::State  state
+        ICoreNode::State  state,
+        bool              reverse = false //!< [in] dependents go first
+    );
+
+    bool
+    isReady(
+        const CoreNode&  node,
+        ICoreNode::State state,
+        bool             reverse
     );
 };
 
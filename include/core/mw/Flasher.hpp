@@ -10,12 +10,39 @@
 #include <core/common.hpp>
 #include <core/mw/impl/Flasher_.hpp>
 
+#include <core/os/Thread.hpp>
+
 NAMESPACE_CORE_MW_BEGIN
 
 #if !defined(CORE_FLASH_ALIGNED) || defined(__DOXYGEN__)
 #define CORE_FLASH_ALIGNED   __attribute__((aligned(Flasher::WORD_ALIGNMENT)))
 #endif
 
+#if !defined(CORE_FLASHER_WORKER_STACK) || defined(__DOXYGEN__)
+#define CORE_FLASHER_WORKER_STACK 256
+#endif
+
+/*! \brief Flash programming
+ *
+ * With a single page buffer, flash() stages the data and programs each page as soon as the next one is addressed:
+ * the caller waits for the erase and program of every page.
+ *
+ * With two page buffers, pages are programmed by a worker thread, started by begin() and stopped by end():
+ * while one page is being erased and programmed, the next one is staged into the other buffer.
+ * The caller only waits when both buffers are busy.
+ *
+ * The two buffers belong to the pipeline: the port implementation is only used, on the first buffer,
+ * within flash_aligned(), erase_aligned() and erase(), after the pipeline has been drained.
+ *
+ * \warning Double buffering only pays off if the caller can run while a page is being erased or programmed:
+ * the flash being programmed must not be the one code is fetched from (i.e.: dual bank flash),
+ * or the receiving path must run from RAM. Otherwise the CPU stalls on instruction fetch,
+ * and the caller waits as with a single buffer.
+ *
+ * \note Pages are handed to the worker as they are left: data for a page must be flashed contiguously
+ * (e.g.: a firmware image, in increasing address order). Going back to a page that is still being programmed
+ * waits for it, and then starts over from its flash contents.
+ */
 
 class Flasher:
     private core::Uncopyable
@@ -44,15 +71,45 @@ public:
 private:
     Flasher_ impl;
 
+    enum class Stage : uint8_t {
+        FREE,      //!< available for staging
+        FILLING,   //!< being filled by flash()
+        COMMITTED  //!< waiting for, or being programmed by, the worker
+    };
+
+    Data*             _buffers[2];
+    PageID            _pages[2];
+    volatile Stage    _stages[2];
+    int               _filling; //!< buffer being filled, -1 if none
+    volatile bool     _error;
+    volatile bool     _run;
+    core::os::Thread* _worker;
+    core::os::Thread* _worker_waiting;
+    core::os::Thread* _writer_waiting;
+
 public:
+    /*! \brief Replace the (first) page buffer
+     *
+     * \pre No flashing in progress.
+     */
     void
     set_page_buffer(
         Data page_buf[]
     );
 
+    /*! \brief Start a flashing session
+     *
+     * When double buffered, the worker thread is started. Should that fail, pages are programmed synchronously.
+     */
     void
     begin();
 
+    /*! \brief Complete a flashing session
+     *
+     * Programs the last staged page and waits for the worker to complete.
+     *
+     * \retval true all the pages have been programmed
+     */
     bool
     end();
 
@@ -88,6 +145,50 @@ public:
         Data page_buf[]
     );
 
+    /*! \brief Double buffered Flasher
+     *
+     * \note Both buffers must be PAGE_SIZE bytes, and aligned as CORE_FLASH_ALIGNED.
+     * \see the warning in the class description.
+     */
+    Flasher(
+        Data page_buf[],
+        Data next_page_buf[]
+    );
+
+private:
+    bool
+    is_double_buffered() const;
+
+    bool
+    stage(
+        const uint8_t* address,
+        const uint8_t* bufp,
+        size_t         buflen
+    );
+
+    void
+    commit();
+
+    bool
+    acquire(
+        PageID page
+    );
+
+    bool
+    drain();
+
+    template <typename F>
+    bool
+    exclusive(
+        F operation
+    );
+
+    void
+    stop();
+
+    void
+    worker();
+
 public:
     static bool
     is_aligned(
@@ -216,48 +317,11 @@ Flasher::is_within_bounds(
     return Flasher_::is_within_bounds(ptr);
 }
 
-inline
-void
-Flasher::set_page_buffer(
-    Data page_buf[]
-)
-{
-    impl.set_page_buffer(page_buf);
-}
-
-inline
-void
-Flasher::begin()
-{
-    impl.begin();
-}
-
 inline
 bool
-Flasher::end()
+Flasher::is_double_buffered() const
 {
-    return impl.end();
-}
-
-inline
-bool
-Flasher::flash_aligned(
-    const Data* address,
-    const Data* bufp,
-    size_t      buflen
-)
-{
-    return impl.flash_aligned(address, bufp, buflen);
-}
-
-inline
-bool
-Flasher::erase_aligned(
-    const Data* address,
-    size_t      length
-)
-{
-    return impl.erase_aligned(address, length);
+    return _buffers[1] != nullptr;
 }
 
 inline
@@ -268,25 +332,46 @@ Flasher::flash(
     size_t         buflen
 )
 {
+    if (is_double_buffered()) {
+        return stage(address, bufp, buflen);
+    }
+
     return impl.flash(address, bufp, buflen);
 }
 
 inline
-bool
-Flasher::erase(
-    const uint8_t* address,
-    size_t         length
+Flasher::Flasher(
+    Data page_buf[]
 )
-{
-    return impl.erase(address, length);
-}
+    :
+    impl(page_buf),
+    _buffers{page_buf, nullptr},
+    _pages{0, 0},
+    _stages{Stage::FREE, Stage::FREE},
+    _filling(-1),
+    _error(false),
+    _run(false),
+    _worker(nullptr),
+    _worker_waiting(nullptr),
+    _writer_waiting(nullptr)
+{}
 
 inline
 Flasher::Flasher(
-    Data page_buf[]
+    Data page_buf[],
+    Data next_page_buf[]
 )
     :
-    impl(page_buf)
+    impl(page_buf),
+    _buffers{page_buf, next_page_buf},
+    _pages{0, 0},
+    _stages{Stage::FREE, Stage::FREE},
+    _filling(-1),
+    _error(false),
+    _run(false),
+    _worker(nullptr),
+    _worker_waiting(nullptr),
+    _writer_waiting(nullptr)
 {}
 
 
@@ -0,0 +1,132 @@
+/* COPYRIGHT (c) 2016-2018 Nova Labs SRL
+ *
+ * All rights reserved. All use of this software and documentation is
+ * subject to the License Agreement located in the file LICENSE.
+ */
+
+#pragma once
+
+#include <core/mw/namespace.hpp>
+#include <core/common.hpp>
+
+NAMESPACE_CORE_MW_BEGIN
+
+/*! \brief LZSS stream format
+ *
+ * The stream is a sequence of groups: a flag byte, followed by up to 8 items, the first one described by the LSB.
+ * - flag 0: a literal byte.
+ * - flag 1: a 2 bytes match, copying MIN_MATCH..MAX_MATCH bytes from 1..WINDOW bytes back in the output.
+ * Byte 0 holds the 8 LSBs of (offset - 1), byte 1 its 2 MSBs, and (length - MIN_MATCH) << 2.
+ *
+ * The stream carries no length: the decoder is told by the user when the output is complete.
+ */
+struct LzCodec {
+    static const std::size_t WINDOW    = 1024;
+    static const std::size_t MIN_MATCH = 3;
+    static const std::size_t MAX_MATCH = MIN_MATCH + 63;
+};
+
+/*! \brief Streaming LZSS encoder
+ *
+ * The whole input must be available. The output is produced a chunk at a time, so that it can be sent as it is encoded.
+ *
+ * \note About 20 KiB of hash tables: meant for the master side.
+ */
+class LzEncoder:
+    private core::Uncopyable
+{
+public:
+    LzEncoder();
+
+    /*! \brief Start encoding a new input
+     */
+    void
+    reset(
+        const uint8_t* data,
+        std::size_t    length
+    );
+
+    /*! \brief Encode the next chunk of the stream
+     *
+     * \return bytes written to out
+     * \retval 0 the stream is complete
+     */
+    std::size_t
+    encode(
+        uint8_t*    out,
+        std::size_t size
+    );
+
+private:
+    static const std::size_t HASH_BITS = 12;
+    static const std::size_t MAX_CHAIN = 32;
+    static const std::size_t GROUP_SIZE = 1 + 8 * 2;
+
+    static std::size_t
+    hash(
+        const uint8_t* p
+    );
+
+    void
+    group();
+
+    void
+    insert(
+        std::size_t position
+    );
+
+    std::size_t
+    match(
+        std::size_t& offset
+    ) const;
+
+    const uint8_t* _data;
+    std::size_t    _length;
+    std::size_t    _position;
+    int32_t        _head[1 << HASH_BITS];
+    int32_t        _prev[LzCodec::WINDOW];
+    uint8_t        _group[GROUP_SIZE];
+    std::size_t    _group_length;
+    std::size_t    _group_sent;
+};
+
+/*! \brief Streaming LZSS decoder
+ *
+ * Input can be fed in chunks of any size, and output is produced into a buffer of any size (e.g.: a Flasher page buffer).
+ * RAM usage is bounded by the LzCodec::WINDOW bytes history.
+ */
+class LzDecoder:
+    private core::Uncopyable
+{
+public:
+    LzDecoder();
+
+    void
+    reset();
+
+    /*! \brief Decode as much input as fits into out
+     *
+     * in and in_length are advanced past the consumed input.
+     *
+     * \return bytes written to out
+     */
+    std::size_t
+    decode(
+        const uint8_t*& in,
+        std::size_t&    in_length,
+        uint8_t*        out,
+        std::size_t     out_size
+    );
+
+private:
+    uint8_t     _window[LzCodec::WINDOW];
+    std::size_t _head;
+    uint8_t     _flags;
+    uint8_t     _items;
+    uint8_t     _token;
+    bool        _have_token;
+    std::size_t _copy_offset;
+    std::size_t _copy_length;
+};
+
+NAMESPACE_CORE_MW_END
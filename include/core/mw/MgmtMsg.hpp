@@ -39,6 +39,9 @@ public:
 
         // Bootloader
         BOOTLOADER = 0x41,
+
+        // Statistics
+        STACK_USAGE = 0x51,
     };
 
     enum {
@@ -73,11 +76,21 @@ public:
 
     CORE_PACKED;
 
+    struct StackUsage {
+        char     module[NamingTraits < Middleware > ::MAX_LENGTH];
+        char     thread[NamingTraits < Node > ::MAX_LENGTH];
+        uint16_t size; //!< working area size [bytes]
+        uint16_t used; //!< high-water mark [bytes]
+    }
+
+    CORE_PACKED;
+
 public:
     union {
-        uint8_t payload[MAX_PAYLOAD_LENGTH];
-        PubSub  pubsub;
-        Module  module;
+        uint8_t    payload[MAX_PAYLOAD_LENGTH];
+        PubSub     pubsub;
+        Module     module;
+        StackUsage stack_usage;
     }
 
     CORE_PACKED;
@@ -176,6 +176,15 @@ public:
         bool        bootload = false
     );
 
+    /*! \brief Publish the stack usage of the profiled threads
+     *
+     * A MgmtMsg::STACK_USAGE message is sent for each thread profiled by StackProfiler.
+     *
+     * \retval true all the messages have been published
+     */
+    bool
+    publish_stack_usage();
+
     void
     add(
         Node& node
@@ -14,11 +14,71 @@
 #include <core/mw/Middleware.hpp>
 #include <core/mw/Publisher.hpp>
 #include <core/mw/Subscriber.hpp>
+#include <core/mw/LockedArrayQueue.hpp>
+#include <core/mw/StaticFunction.hpp>
+#include <core/mw/StackProfiler.hpp>
 #include <core/ConstString.hpp>
 
 #include <core/mw/RPCMessages.hpp>
 
-#include <functional>
+#if !defined(CORE_RPC_MAX_WORKERS) || defined(__DOXYGEN__)
+#define CORE_RPC_MAX_WORKERS           4
+#endif
+
+#if !defined(CORE_RPC_WORKER_QUEUE_LENGTH) || defined(__DOXYGEN__)
+#define CORE_RPC_WORKER_QUEUE_LENGTH   8
+#endif
+
+// Session tables: 5 bytes per entry (on 32 bit targets), for each RPC instance. Ids are 16 bit, up to 65534 entries.
+#if !defined(CORE_RPC_MAX_CLIENTS) || defined(__DOXYGEN__)
+#define CORE_RPC_MAX_CLIENTS           32
+#endif
+
+#if !defined(CORE_RPC_MAX_SERVERS) || defined(__DOXYGEN__)
+#define CORE_RPC_MAX_SERVERS           32
+#endif
+
+/*! \brief Per boot seed of the session generations
+ *
+ * Taken when the first client or server is added. By default it comes from the time elapsed since boot,
+ * which jitters from boot to boot: ports with a random number generator or a boot counter should use them instead.
+ */
+#if !defined(CORE_RPC_GENERATION_SEED) || defined(__DOXYGEN__)
+#define CORE_RPC_GENERATION_SEED() (core::os::Time::now().to_us_raw())
+#endif
+
+#if !defined(CORE_RPC_DISCOVERY_CACHE_LENGTH) || defined(__DOXYGEN__)
+#define CORE_RPC_DISCOVERY_CACHE_LENGTH 16
+#endif
+
+//! Incoming messages queue: it must absorb the DISCOVER_RESPONSE burst triggered by RPC::open_all()
+#if !defined(CORE_RPC_QUEUE_LENGTH) || defined(__DOXYGEN__)
+#define CORE_RPC_QUEUE_LENGTH 16
+#endif
+
+//! Pause between the DISCOVER_RESPONSE messages sent by a module to a RPC::open_all() request
+#if !defined(CORE_RPC_DISCOVERY_GAP_MS) || defined(__DOXYGEN__)
+#define CORE_RPC_DISCOVERY_GAP_MS 2
+#endif
+
+//! RPC::open_all() requests a module answers at the same time, further ones are dropped (they are broadcast again)
+#if !defined(CORE_RPC_DISCOVERY_ANNOUNCEMENTS) || defined(__DOXYGEN__)
+#define CORE_RPC_DISCOVERY_ANNOUNCEMENTS 4
+#endif
+
+//! How long a client waits for a DISCOVER_RESPONSE, whatever the timeout of its calls
+#if !defined(CORE_RPC_DISCOVERY_TIMEOUT_MS) || defined(__DOXYGEN__)
+#define CORE_RPC_DISCOVERY_TIMEOUT_MS 1000
+#endif
+
+//! Number of times RPC::open_all() broadcasts its request, when some clients are still not resolved
+#if !defined(CORE_RPC_DISCOVERY_ROUNDS) || defined(__DOXYGEN__)
+#define CORE_RPC_DISCOVERY_ROUNDS 3
+#endif
+
+#ifndef CORE_RPC_STATS
+#define CORE_RPC_STATS 0
+#endif
 
 NAMESPACE_CORE_MW_BEGIN
 namespace rpc {
@@ -89,8 +149,128 @@ public:
     RPCMessage*       _inbound_message;
     RPCMessage*       _outbound_message;
     uint8_t           _id;
+#if CORE_RPC_STATS
+    core::os::Time    _start;
+#endif
 };
 
+#if CORE_RPC_STATS
+/*! \brief RPC statistics
+ *
+ * Latencies are collected in a log-linear histogram: each power of two [2^k, 2^(k+1)) us is split in
+ * SUB_BUCKETS equal buckets, so that percentiles are within 1/SUB_BUCKETS of the actual value.
+ * Latencies below SUB_BUCKETS us have a bucket each, those above 2^OCTAVES us all fall in the last bucket.
+ */
+struct Stats {
+    static const std::size_t SUB_BUCKETS_BITS = 3;
+    static const std::size_t SUB_BUCKETS      = 1 << SUB_BUCKETS_BITS;
+    static const std::size_t OCTAVES = 20;
+    static const std::size_t BUCKETS = (OCTAVES - SUB_BUCKETS_BITS + 1) * SUB_BUCKETS;
+
+    uint32_t discoveries;
+    uint32_t discovery_failures;
+    uint32_t discovery_time_max; //!< [us]
+    uint32_t calls;
+    uint32_t call_failures;
+    uint32_t local_calls;
+    uint32_t async_completions;
+    uint32_t latency_max; //!< [us]
+    uint64_t latency_total; //!< [us]
+    uint32_t latency[BUCKETS];
+
+    static std::size_t
+    bucket(
+        uint32_t us
+    )
+    {
+        if (us < SUB_BUCKETS) {
+            return us;
+        }
+
+        std::size_t msb = SUB_BUCKETS_BITS;
+
+        while ((us >> (msb + 1)) != 0) {
+            msb++;
+        }
+
+        std::size_t index = (msb - SUB_BUCKETS_BITS + 1) * SUB_BUCKETS + ((us >> (msb - SUB_BUCKETS_BITS)) & (SUB_BUCKETS - 1));
+
+        return (index < BUCKETS) ? index : BUCKETS - 1;
+    } // bucket
+
+    //! Highest latency that falls in a bucket [us]
+    static uint32_t
+    bucket_upper(
+        std::size_t index
+    )
+    {
+        if (index < SUB_BUCKETS) {
+            return index;
+        }
+
+        std::size_t shift = index / SUB_BUCKETS - 1;
+
+        return (((SUB_BUCKETS + (index % SUB_BUCKETS)) + 1) << shift) - 1;
+    }
+
+    void
+    add_latency(
+        uint32_t us
+    )
+    {
+        latency[bucket(us)]++;
+        latency_total += us;
+
+        if (us > latency_max) {
+            latency_max = us;
+        }
+    }
+
+    /*! \brief Latency percentile
+     *
+     * \return upper bound of the bucket that holds the percentile, or the maximum latency if lower [us]
+     */
+    uint32_t
+    percentile(
+        unsigned p //!< [in] percentile, 0-100
+    ) const
+    {
+        uint32_t total = 0;
+
+        for (std::size_t i = 0; i < BUCKETS; i++) {
+            total += latency[i];
+        }
+
+        uint32_t threshold = static_cast<uint32_t>((static_cast<uint64_t>(total) * p + 99) / 100);
+        uint32_t count     = 0;
+
+        for (std::size_t i = 0; i < BUCKETS; i++) {
+            count += latency[i];
+
+            if ((count >= threshold) && (count > 0)) {
+                uint32_t upper = bucket_upper(i);
+
+                return (upper < latency_max) ? upper : latency_max;
+            }
+        }
+
+        return 0;
+    } // percentile
+
+    uint32_t
+    latency_mean() const
+    {
+        uint32_t completed = 0;
+
+        for (std::size_t i = 0; i < BUCKETS; i++) {
+            completed += latency[i];
+        }
+
+        return (completed != 0) ? static_cast<uint32_t>(latency_total / completed) : 0;
+    }
+};
+#endif // if CORE_RPC_STATS
+
 class RPCBase;
 
 class ServerBase
@@ -99,14 +279,16 @@ class ServerBase
     friend class RPC;
 
 public:
-    ServerBase() : _rpc(nullptr), _rpc_name(""), _id(0), _timeout(core::os::Time::INFINITE), _by_rpc(*this)
+    ServerBase() : _rpc(nullptr), _rpc_name(""), _id(0), _generation(0), _timeout(core::os::Time::INFINITE), _pooled(false), _calls(0), _by_rpc(*this)
     {
+        _invoke_lock.initialize();
     }
 
     ServerBase(
         const char* rpc_name
-    ) : _rpc(nullptr), _rpc_name(rpc_name), _id(0), _timeout(core::os::Time::INFINITE), _by_rpc(*this)
+    ) : _rpc(nullptr), _rpc_name(rpc_name), _id(0), _generation(0), _timeout(core::os::Time::INFINITE), _pooled(false), _calls(0), _by_rpc(*this)
     {
+        _invoke_lock.initialize();
     }
 
     virtual ~ServerBase() {}
@@ -117,12 +299,36 @@ public:
         void*       response
     ) = 0;
 
+    /*! \brief Run the callback on the RPC worker pool
+     *
+     * When enabled, and the RPC has been given workers with RPC::startWorkers(),
+     * requests for this server are handed over to a worker, so that a slow callback does not stall
+     * the dispatcher thread. Requests to the same server are still served one at a time.
+     * RPC::removeServer() waits for the requests already queued.
+     */
+    void
+    pooled(
+        bool pooled
+    )
+    {
+        _pooled = pooled;
+    }
+
+    bool
+    pooled() const
+    {
+        return _pooled;
+    }
 
 protected:
     RPCBase*       _rpc;
     core::ConstString<RPCName::SIZE> _rpc_name;
-    uint8_t        _id;
+    SessionId      _id;
+    Generation     _generation;
     core::os::Time _timeout;
+    bool           _pooled;
+    std::size_t    _calls; // Calls that still use the server, guarded by RPCBase::_lock
+    core::os::Mutex _invoke_lock;
 //    Transaction    transaction;
     mutable StaticList<ServerBase>::Link _by_rpc;
 };
@@ -140,7 +346,7 @@ public:
 public:
     ClientBase(
         const char* rpc_name
-    ) : _rpc(nullptr), _rpc_name(rpc_name), _id(0), _server_id(0), _state(State::NONE), _service(nullptr), _timeout(core::os::Time::s(1)), _private(nullptr), _by_rpc(*this)
+    ) : _rpc(nullptr), _rpc_name(rpc_name), _id(0), _generation(0), _server_id(0), _server_generation(0), _local(nullptr), _state(State::NONE), _service(nullptr), _timeout(core::os::Time::s(1)), _private(nullptr), _by_rpc(*this)
     {
         _server_name.clear();
     }
@@ -155,6 +361,16 @@ public:
         return _server_id != 0;
     }
 
+    /*! \brief A call is ongoing
+     *
+     * For asynchronous clients, it becomes false after the callback has returned.
+     */
+    bool
+    busy() const
+    {
+        return _state == State::BUSY;
+    }
+
     void
     setPrivateData(
         void* private_data
@@ -175,9 +391,12 @@ public:
 protected:
     RPCBase*       _rpc;
     core::ConstString<RPCName::SIZE> _rpc_name;
-    uint8_t        _id;
+    SessionId      _id;
+    Generation     _generation;
     ModuleName     _server_name;
-    uint8_t        _server_id;
+    SessionId      _server_id;
+    Generation     _server_generation;
+    ServerBase*    _local;
     Transaction    transaction;
     State          _state;
     BaseServ*      _service;
@@ -191,17 +410,68 @@ class RPCBase
 public:
     RPCBase(
         const char* name
-    ) : _name(name), _runner(nullptr), _sequence(0), _sub_node("RPCSub", false), _pub_node("RPCPub")
+    ) : _name(name), _runner(nullptr), _sequence(0), _sub_node("RPCSub", false), _pub_node("RPCPub"), _cache(), _cache_ttl(core::os::Time::s(60))
+#if CORE_RPC_STATS
+        , _stats()
+#endif
     {
         _lock.initialize();
+        _cache_lock.initialize();
     }
 
-    RPCBase() : _name(nullptr), _runner(nullptr), _sequence(0), _sub_node("RPCSub", false), _pub_node("RPCPub")
+    RPCBase() : _name(nullptr), _runner(nullptr), _sequence(0), _sub_node("RPCSub", false), _pub_node("RPCPub"), _cache(), _cache_ttl(core::os::Time::s(60))
+#if CORE_RPC_STATS
+        , _stats()
+#endif
     {}
 
     void initialize(const char* name) {
         _name = name;
         _lock.initialize();
+        _cache_lock.initialize();
+    }
+
+#if CORE_RPC_STATS
+    Stats
+    stats()
+    {
+        core::os::SysLock::Scope lock;
+
+        return _stats;
+    }
+
+    void
+    reset_stats()
+    {
+        core::os::SysLock::Scope lock;
+
+        _stats = Stats();
+    }
+#endif
+
+    /*! \brief Set how long a discovered server is remembered
+     *
+     * Servers seen in DISCOVER_RESPONSE messages are cached, and clients opened within the TTL are bound
+     * without any network traffic. A TTL of 0 disables the cache.
+     */
+    void
+    discoveryCacheTTL(
+        core::os::Time ttl
+    )
+    {
+        _cache_ttl = ttl;
+    }
+
+    /*! \brief The pending asynchronous call of a client will never complete
+     *
+     * E.g.: its response has been lost. The server is dropped from the discovery cache, as it may be gone.
+     */
+    void
+    abandon(
+        ClientBase& client
+    )
+    {
+        forgetServer(client._rpc_name);
     }
 
     bool
@@ -228,6 +498,20 @@ public:
             client._state = ClientBase::State::BUSY;
         }
 
+#if CORE_RPC_STATS
+        client.transaction._start = core::os::Time::now();
+#endif
+
+        if (client._local != nullptr) {
+            success = callLocal(client, serv, private_data);
+
+#if CORE_RPC_STATS
+            recordCall(client, success, true);
+#endif
+
+            return success;
+        }
+
         if (beginClientTransaction(client)) {
         	client.setPrivateData(private_data);
             client._service = &serv;
@@ -237,6 +521,7 @@ public:
             request->header.type = MessageType::REQUEST;
             request->header.target_module_name = client._server_name;
             request->header.server_session     = client._server_id;
+            request->header.server_generation  = client._server_generation;
 
             CORE_ASSERT(serv.getRequestSize() < RPCMessage::PAYLOAD_SIZE);
 
@@ -245,7 +530,20 @@ public:
             if (client.transaction._timeout == core::os::Time::IMMEDIATE) {
                 if (executeClientTransaction_async(client)) {
                     success = true;
+                } else {
+                    // As for synchronous calls: the server may be gone
+                    forgetServer(client._rpc_name);
+                    endClientTransaction(client);
+
+                    client._service = nullptr;
+                    client._state   = ClientBase::State::READY;
+                }
+
+#if CORE_RPC_STATS
+                if (!success) {
+                    recordCall(client, false, false);
                 }
+#endif
             } else {
                 if (executeClientTransaction(client)) {
                     RPCMessage* response = client.transaction._inbound_message;
@@ -255,10 +553,17 @@ public:
                     std::memcpy(serv.getResponse(), response->payload, serv.getResponseSize());
 
                     success = true;
+                } else {
+                    // The server may be gone, do not hand it out to other clients
+                    forgetServer(client._rpc_name);
                 }
 
                 endClientTransaction(client);
 
+#if CORE_RPC_STATS
+                recordCall(client, success, false);
+#endif
+
                 client._service = nullptr;
                 client._state   = ClientBase::State::READY;
             }
@@ -283,22 +588,44 @@ public:
 
         client._server_name = "";
         client._server_id   = 0;
+        client._local       = nullptr;
         bool success = false;
 
-        if (beginClientTransaction(client)) {
+#if CORE_RPC_STATS
+        core::os::Time start = core::os::Time::now();
+#endif
+
+        ServerBase* server = findLocalServer(client._rpc_name);
+
+        if (server != nullptr) {
+            // The server lives here: bypass the topic and invoke it directly
+            client._server_name = _name;
+            client._server_id   = server->_id;
+            client._server_generation = server->_generation;
+            client._local       = server;
+            success = true;
+        } else if (lookupServer(client)) {
+            // We have recently seen the server
+            success = true;
+        } else if (beginClientTransaction(client)) {
             RPCMessage* request = client.transaction._outbound_message;
 
             request->header.type = MessageType::DISCOVER_REQUEST;
             request->header.target_module_name.clear();
             request->header.server_session = 0;
+            request->header.server_generation = 0;
             request->discovery_request.client_name = _name;
             request->discovery_request.rpc_name    = client._rpc_name;
 
+            // Once open, asynchronous clients have an IMMEDIATE timeout: that would not do for discovery
+            client.transaction._timeout = core::os::Time::ms(CORE_RPC_DISCOVERY_TIMEOUT_MS);
+
             if (executeClientTransaction(client)) {
                 RPCMessage* response = client.transaction._inbound_message;
 
                 client._server_name = response->discovery_response.server_name;
                 client._server_id   = response->header.server_session;
+                client._server_generation = response->header.server_generation;
                 success = true;
             }
 
@@ -312,10 +639,36 @@ public:
             client._state = ClientBase::State::NONE;
         }
 
+#if CORE_RPC_STATS
+        {
+            uint32_t elapsed = (core::os::Time::now() - start).to_us_raw();
+
+            core::os::SysLock::Scope lock;
+
+            _stats.discoveries++;
+
+            if (!success) {
+                _stats.discovery_failures++;
+            }
+
+            if (elapsed > _stats.discovery_time_max) {
+                _stats.discovery_time_max = elapsed;
+            }
+        }
+#endif
+
         return success;
     } // discover
 
 protected:
+    struct CachedServer {
+        RPCName        rpc_name;
+        ModuleName     server_name;
+        SessionId      server_session;
+        Generation     server_generation;
+        core::os::Time timestamp;
+    };
+
     const char*       _name;
     core::os::Mutex   _lock;
     core::os::Thread* _runner;
@@ -323,9 +676,210 @@ protected:
     core::mw::Node    _sub_node;
     core::mw::Node    _pub_node;
     core::mw::Publisher<RPCMessage>     _pub;
-    core::mw::Subscriber<RPCMessage, 5> _sub;
+    core::mw::Subscriber<RPCMessage, CORE_RPC_QUEUE_LENGTH> _sub;
+
+    core::os::Mutex   _cache_lock;
+    CachedServer      _cache[CORE_RPC_DISCOVERY_CACHE_LENGTH];
+    core::os::Time    _cache_ttl;
+
+#if CORE_RPC_STATS
+    Stats _stats;
+#endif
 
 protected:
+#if CORE_RPC_STATS
+    void
+    recordCall(
+        ClientBase& client,
+        bool        success,
+        bool        local
+    )
+    {
+        uint32_t elapsed = (core::os::Time::now() - client.transaction._start).to_us_raw();
+
+        core::os::SysLock::Scope lock;
+
+        _stats.calls++;
+
+        if (local) {
+            _stats.local_calls++;
+        }
+
+        if (success) {
+            _stats.add_latency(elapsed);
+        } else {
+            _stats.call_failures++;
+        }
+    } // recordCall
+#endif
+
+    bool
+    isFresh(
+        const CachedServer& entry,
+        const core::os::Time& now
+    ) const
+    {
+        return (entry.server_session != 0) && (now - entry.timestamp < _cache_ttl);
+    }
+
+    /*! \brief Bind a client to a cached server
+     *
+     * \retval true the server was in the cache, and it has not expired
+     */
+    bool
+    lookupServer(
+        ClientBase& client
+    )
+    {
+        core::os::ScopedLock<core::os::Mutex> lock(_cache_lock);
+
+        core::os::Time now = core::os::Time::now();
+
+        for (const CachedServer& entry : _cache) {
+            if (isFresh(entry, now) && (entry.rpc_name == client._rpc_name)) {
+                client._server_name       = entry.server_name;
+                client._server_id         = entry.server_session;
+                client._server_generation = entry.server_generation;
+
+                return true;
+            }
+        }
+
+        return false;
+    } // lookupServer
+
+    /*! \brief Remember the server announced by a DISCOVER_RESPONSE
+     *
+     * The entry for the same RPC is refreshed, otherwise the oldest one is replaced.
+     */
+    void
+    rememberServer(
+        const RPCMessage& response
+    )
+    {
+        core::os::ScopedLock<core::os::Mutex> lock(_cache_lock);
+
+        core::os::Time now    = core::os::Time::now();
+        CachedServer*  victim = &_cache[0];
+
+        for (CachedServer& entry : _cache) {
+            if ((entry.server_session != 0) && (entry.rpc_name == response.discovery_response.rpc_name)) {
+                victim = &entry;
+                break;
+            }
+
+            if (!isFresh(entry, now)) {
+                victim = &entry;
+            } else if (isFresh(*victim, now) && (now - entry.timestamp > now - victim->timestamp)) {
+                victim = &entry;
+            }
+        }
+
+        victim->rpc_name          = response.discovery_response.rpc_name;
+        victim->server_name       = response.discovery_response.server_name;
+        victim->server_session    = response.header.server_session;
+        victim->server_generation = response.header.server_generation;
+        victim->timestamp         = now;
+    } // rememberServer
+
+    void
+    forgetServer(
+        const core::ConstString<RPCName::SIZE>& rpc_name
+    )
+    {
+        core::os::ScopedLock<core::os::Mutex> lock(_cache_lock);
+
+        for (CachedServer& entry : _cache) {
+            if (entry.rpc_name == rpc_name) {
+                entry.server_session = 0;
+            }
+        }
+    }
+
+    /*! \brief Look for a server registered to this RPC
+     *
+     * \return the server, or nullptr if the RPC is not served locally
+     */
+    virtual ServerBase*
+    findLocalServer(
+        const core::ConstString<RPCName::SIZE>& rpc_name
+    )
+    {
+        (void)rpc_name;
+
+        return nullptr;
+    }
+
+    /*! \brief Call a server that lives in this RPC
+     *
+     * The server is invoked on the caller thread, without going through the topic.
+     * For asynchronous clients the callback is also executed on the caller thread, before returning.
+     */
+    bool
+    callLocal(
+        ClientBase& client,
+        BaseServ&   serv,
+        void*       private_data
+    )
+    {
+        bool        success;
+        ServerBase* server;
+
+        {
+            // removeServer() waits for the calls it has not seen cleared
+            core::os::ScopedLock<core::os::Mutex> lock(_lock);
+
+            server = client._local;
+
+            if (server != nullptr) {
+                server->_calls++;
+            }
+        }
+
+        if (server == nullptr) {
+            // The server has just been removed, the client must discover it again
+            return false;
+        }
+
+        client.setPrivateData(private_data);
+        client._service = &serv;
+
+        {
+            core::os::ScopedLock<core::os::Mutex> lock(server->_invoke_lock);
+
+            success = server->invoke(serv.getRequest(), serv.getResponse());
+        }
+
+        {
+            core::os::ScopedLock<core::os::Mutex> lock(_lock);
+
+            server->_calls--;
+        }
+
+        if (success && (client.transaction._timeout == core::os::Time::IMMEDIATE)) {
+#if CORE_RPC_STATS
+            {
+                core::os::SysLock::Scope lock;
+                _stats.async_completions++;
+            }
+#endif
+            client.invoke();
+        }
+
+        client._service = nullptr;
+
+        {
+            core::os::ScopedLock<core::os::Mutex> lock(_lock);
+
+            // Unless removeServer() has disconnected the client meanwhile
+            if (client._state == ClientBase::State::BUSY) {
+                client._state = ClientBase::State::READY;
+            }
+        }
+
+        return success;
+    } // callLocal
+
     bool
     beginClientTransaction(
         ClientBase& client
@@ -353,6 +907,7 @@ protected:
     {
         client.transaction._outbound_message->header.sequence       = client.transaction._sequence;
         client.transaction._outbound_message->header.client_session = client._id;
+        client.transaction._outbound_message->header.client_generation = client._generation;
 
         if (!_pub.publish_loopback(client.transaction._outbound_message)) {
             return false;
@@ -368,6 +923,7 @@ protected:
     {
         client.transaction._outbound_message->header.sequence       = client.transaction._sequence;
         client.transaction._outbound_message->header.client_session = client._id;
+        client.transaction._outbound_message->header.client_generation = client._generation;
 
         if (!_pub.publish_loopback(client.transaction._outbound_message)) {
             return false;
@@ -424,17 +980,20 @@ class Server:
 {
 public:
     using Service      = SERVICE;
-    using CallbackType = std::function<void(Service&)>;
+    using Request      = typename Service::Request;
+    using Response     = typename Service::Response;
+    using CallbackType = StaticFunction<void(Service&)>;
+    using HandlerType  = StaticFunction<void(const Request&, Response&)>;
 
     static_assert(std::is_base_of<BaseServ, Service>::value, "Service does not inherit from BaseServ");
 
 public:
     Server(
-    ) : ServerBase::ServerBase(), _callback() {}
+    ) : ServerBase::ServerBase(), _callback(), _handler() {}
 
     Server(
         const char* rpc_name
-    ) : ServerBase::ServerBase(rpc_name), _callback() {}
+    ) : ServerBase::ServerBase(rpc_name), _callback(), _handler() {}
 
     static bool
     invoke(
@@ -459,21 +1018,43 @@ public:
         void*       response
     )
     {
-        Service ss;
-
-        std::memcpy(ss.getRequest(), request, ss.getRequestSize());
-
-        if (_callback) {
-            _callback(ss);
+        if (_handler) {
+            if (isAligned<Request>(request) && isAligned<Response>(response)) {
+                // Work straight on the payloads, no copies
+                _handler(*reinterpret_cast<const Request*>(request), *reinterpret_cast<Response*>(response));
+            } else {
+                // A misaligned view would fault (or be miscompiled) on targets without unaligned access:
+                // go through a properly aligned copy
+                Service ss;
 
-            std::memcpy(response, ss.getResponse(), ss.getResponseSize());
+                std::memcpy(ss.getRequest(), request, ss.getRequestSize());
+                _handler(ss.request, ss.response);
+                std::memcpy(response, ss.getResponse(), ss.getResponseSize());
+            }
 
             return true;
         }
 
-        return false;
+        if (!_callback) {
+            return false;
+        }
+
+        // The callback takes a Service, which holds both the request and the response:
+        // they live in two different messages, so they cannot be handed over in place
+        Service ss;
+
+        std::memcpy(ss.getRequest(), request, ss.getRequestSize());
+        _callback(ss);
+        std::memcpy(response, ss.getResponse(), ss.getResponseSize());
+
+        return true;
     }
 
+    /*! \brief Set the request callback
+     *
+     * The callback gets a Service, so the request is copied in and the response copied out.
+     * Use handler() to work on the payloads in place.
+     */
     void
     callback(
         CallbackType callback
@@ -482,12 +1063,36 @@ public:
         _callback = callback;
     }
 
+    /*! \brief Set the request handler
+     *
+     * The handler works directly on the request and response payloads,
+     * without building a Service and without copying the data around.
+     * If set, it takes precedence over the callback.
+     */
+    void
+    handler(
+        HandlerType handler
+    )
+    {
+        _handler = handler;
+    }
+
     operator bool() {
         return _id != 0;
     }
 
 private:
     CallbackType _callback;
+    HandlerType  _handler;
+
+    template <typename T>
+    static bool
+    isAligned(
+        const void* p
+    )
+    {
+        return (reinterpret_cast<std::uintptr_t>(p) % alignof(T)) == 0;
+    }
 };
 
 
@@ -499,7 +1104,7 @@ class Client:
 
 public:
     using Service      = SERVICE;
-    using CallbackType = std::function<void(Service&)>;
+    using CallbackType = StaticFunction<void(Service&)>;
 
 public:
     //Client() : ClientBase::ClientBase() {};
@@ -536,8 +1141,15 @@ public:
     bool
     close()
     {
+        if ((_state == State::BUSY) && (_rpc != nullptr)) {
+            // The response of an asynchronous call has not come back
+            _rpc->abandon(*this);
+        }
+
         _server_id = 0;
         _server_name.clear();
+        _local = nullptr;
+        _state = State::NONE;
 
         return true;
     }
@@ -546,8 +1158,10 @@ public:
     invoke()
     {
         if (_callback) {
-            const void* tmp = &(transaction._inbound_message->payload[0]);
-            std::memcpy(_service->getResponse(), tmp, _service->getResponseSize());
+            if (transaction._inbound_message != nullptr) {
+                const void* tmp = &(transaction._inbound_message->payload[0]);
+                std::memcpy(_service->getResponse(), tmp, _service->getResponseSize());
+            }
 
             _callback(*reinterpret_cast<Service*>(_service));
 
@@ -578,12 +1192,25 @@ private:
 class RPC:
     public RPCBase
 {
+private:
+    // A RPC::open_all() request being answered, only used by the dispatcher
+    struct Announcement {
+        ModuleName     client_name;
+        SessionId      client_session;
+        Generation     client_generation;
+        uint8_t        sequence;
+        std::size_t    next_slot; // Next _server_table slot to announce
+        uint8_t        failures;
+        core::os::Time due;
+        bool           active;
+    };
+
 public:
     RPC(
         const char* name
-    ) : RPCBase::RPCBase(name), _runner(nullptr), _running(false), _next_client_id(0), _next_server_id(0) {}
+    ) : RPCBase::RPCBase(name), _runner(nullptr), _running(false), _jobs(_jobs_buf, CORE_RPC_WORKER_QUEUE_LENGTH), _num_workers(0), _next_client_id(0), _next_server_id(0), _client_table(), _client_generations(), _server_table(), _server_generations(), _generation_seed(0), _seeded(false), _announcements() {}
 
-    RPC() : RPCBase::RPCBase(), _runner(nullptr), _running(false), _next_client_id(0), _next_server_id(0) {}
+    RPC() : RPCBase::RPCBase(), _runner(nullptr), _running(false), _jobs(_jobs_buf, CORE_RPC_WORKER_QUEUE_LENGTH), _num_workers(0), _next_client_id(0), _next_server_id(0), _client_table(), _client_generations(), _server_table(), _server_generations(), _generation_seed(0), _seeded(false), _announcements() {}
 
     bool
     start(
@@ -596,7 +1223,7 @@ public:
             return false;
         }
 
-        _runner = core::os::Thread::create_heap(nullptr, stack_size, core::os::Thread::PriorityEnum::NORMAL - 2, [](void* arg) {
+        _runner = StackProfiler::create_heap(stack_size, core::os::Thread::PriorityEnum::NORMAL - 2, [](void* arg) {
                 reinterpret_cast<core::mw::rpc::RPC*>(arg)->thread();
             }, this, "rpcthd");
 
@@ -611,6 +1238,108 @@ public:
         return true;
     }
 
+    /*! \brief Open all the clients
+     *
+     * A single discovery request asks all the modules to announce all their servers.
+     * The responses for the RPCs used by the clients fill the discovery cache, from which the clients are then bound.
+     * Modules pace their responses (CORE_RPC_DISCOVERY_GAP_MS), and the request is broadcast again,
+     * up to CORE_RPC_DISCOVERY_ROUNDS times, while some clients are not resolved.
+     * Clients that could not be resolved within the timeout fall back to the usual discovery.
+     *
+     * \note CORE_RPC_DISCOVERY_CACHE_LENGTH must be at least the number of remote RPCs used by the clients.
+     *
+     * \retval true all the clients are open
+     */
+    bool
+    open_all(
+        core::os::Time timeout = core::os::Time::s(1)
+    )
+    {
+        const core::os::Time slice    = core::os::Time::us(timeout.to_us_raw() / CORE_RPC_DISCOVERY_ROUNDS);
+        core::os::Time       deadline = core::os::Time::now();
+        bool                 cached   = false;
+
+        for (std::size_t round = 0; !cached && (round < CORE_RPC_DISCOVERY_ROUNDS); round++) {
+            RPCMessage* request;
+
+            if (!_pub.alloc(request)) {
+                break;
+            }
+
+            request->header.type = MessageType::DISCOVER_REQUEST;
+            request->header.sequence = 0;
+            request->header.target_module_name.clear();
+            request->header.client_session    = 0;
+            request->header.client_generation = 0;
+            request->header.server_session    = 0;
+            request->header.server_generation = 0;
+            request->discovery_request.client_name = _name;
+            request->discovery_request.rpc_name.clear();
+
+            if (!_pub.publish_loopback(request)) {
+                break;
+            }
+
+            deadline = deadline + slice;
+
+            while (!cached && (core::os::Time::now() < deadline)) {
+                core::os::Thread::sleep(core::os::Time::ms(10));
+
+                cached = allCached();
+            }
+        }
+
+        bool success = true;
+
+        // Clients are looked up by session id, so that the list is never walked without the lock
+        for (std::size_t i = 0; i < CORE_RPC_MAX_CLIENTS; i++) {
+            ClientBase* client;
+
+            {
+                core::os::ScopedLock<core::os::Mutex> lock(_lock);
+
+                client = _client_table[i];
+            }
+
+            if (client != nullptr) {
+                success &= discover(*client);
+            }
+        }
+
+        return success;
+    } // open_all
+
+    /*! \brief Spawn the worker pool for pooled servers
+     *
+     * Workers serve the requests of the servers that have been marked with ServerBase::pooled().
+     * At most CORE_RPC_MAX_WORKERS workers can be spawned, and at most CORE_RPC_WORKER_QUEUE_LENGTH requests can be pending.
+     * When the queue is full, the request is served inline by the dispatcher thread.
+     *
+     * \return the number of workers that are running
+     */
+    std::size_t
+    startWorkers(
+        std::size_t count,
+        std::size_t stack_size
+    )
+    {
+        core::os::ScopedLock<core::os::Mutex> lock(_lock);
+
+        while ((_num_workers < count) && (_num_workers < CORE_RPC_MAX_WORKERS)) {
+            core::os::Thread* worker = StackProfiler::create_heap(stack_size, core::os::Thread::PriorityEnum::NORMAL - 2, [](void* arg) {
+                    reinterpret_cast<core::mw::rpc::RPC*>(arg)->worker();
+                }, this, "rpcwrk");
+
+            if (worker == nullptr) {
+                break;
+            }
+
+            _num_workers++;
+        }
+
+        return _num_workers;
+    } // startWorkers
+
     bool
     addClient(
         ClientBase& client
@@ -622,9 +1351,20 @@ public:
         	return false;
         }
 
+        SessionId id = getNextClientId();
+
+        if (id == 0) {
+            CORE_ASSERT(!"RPC client table full: increase CORE_RPC_MAX_CLIENTS");
+            return false;
+        }
+
+        std::size_t slot = id - 1;
+
         client._rpc = this;
         _clients.link(client._by_rpc);
-        client._id = getNextClientId();
+        _client_table[slot] = &client;
+        client._id         = id;
+        client._generation = nextGeneration(_client_generations[slot]);
         client._server_name = "";
 
         return true;
@@ -637,15 +1377,17 @@ public:
     {
     	core::os::ScopedLock<core::os::Mutex> lock(_lock);
 
-        if(client._rpc == nullptr) {
+        if(client._rpc != this) {
         	return false;
         }
 
         _clients.unlink(client._by_rpc);
+        _client_table[client._id - 1] = nullptr;
 
         client._rpc = nullptr;
         client._server_name = "";
         client._server_id   = 0;
+        client._local       = nullptr;
         client._id = 0;
 
         return true;
@@ -668,9 +1410,23 @@ public:
             }
         }
 
+        SessionId id = getNextServerId();
+
+        if (id == 0) {
+            CORE_ASSERT(!"RPC server table full: increase CORE_RPC_MAX_SERVERS");
+            server._rpc = nullptr;
+            server._id  = 0;
+
+            return false;
+        }
+
+        std::size_t slot = id - 1;
+
         server._rpc = this;
         _servers.link(server._by_rpc);
-        server._id = getNextServerId();
+        _server_table[slot] = &server;
+        server._id         = id;
+        server._generation = nextGeneration(_server_generations[slot]);
 
         return true;
     } // addServer
@@ -685,20 +1441,56 @@ public:
         return addServer(server);
     } // addServer
 
+    /*! \brief Remove a server
+     *
+     * Returns once the calls still running on the server, and the requests queued for its workers, are done.
+     *
+     * \warning Must not be called from the callback of the server being removed.
+     */
     bool
     removeServer(
         ServerBase& server
     )
     {
-    	core::os::ScopedLock<core::os::Mutex> lock(_lock);
+        {
+            core::os::ScopedLock<core::os::Mutex> lock(_lock);
+
+            if (server._rpc != this) {
+                return false;
+            }
+
+            _servers.unlink(server._by_rpc);
+            _server_table[server._id - 1] = nullptr;
 
-        _servers.unlink(server._by_rpc);
+            // Local clients must discover the RPC again
+            for (ClientBase& client : _clients) {
+                if (client._local == &server) {
+                    client._server_name = "";
+                    client._server_id   = 0;
+                    client._local       = nullptr;
+                    client._state       = ClientBase::State::NONE;
+                }
+            }
 
-        server._rpc = nullptr;
-        server._id  = 0;
+            server._rpc = nullptr;
+            server._id  = 0;
+        }
+
+        // Nobody can reach the server anymore, wait for the local calls and the queued requests
+        while (true) {
+            {
+                core::os::ScopedLock<core::os::Mutex> lock(_lock);
+
+                if (server._calls == 0) {
+                    break;
+                }
+            }
+
+            core::os::Thread::sleep(core::os::Time::ms(1));
+        }
 
         return true;
-    }
+    } // removeServer
 
     bool
     processDiscoverRequest(
@@ -707,24 +1499,60 @@ public:
     {
         RPCMessage* request = message;
 
-        for (ServerBase& server : _servers) {
-            if (request->discovery_request.rpc_name == server._rpc_name) {
-                // We have a server
-                RPCMessage* response_message;
-
-                if (_pub.alloc(response_message)) {
-                    RPCMessage* response = response_message;
-                    response->header.type     = core::mw::rpc::MessageType::DISCOVER_RESPONSE;
-                    response->header.sequence = request->header.sequence;
-                    response->header.target_module_name      = request->discovery_request.client_name;
-                    response->header.client_session          = request->header.client_session;
-                    response->header.server_session          = server._id;
-                    response->discovery_response.rpc_name    = server._rpc_name;  // TODO: remove - it will not be used
-                    response->discovery_response.server_name = _name;
-
-                    if (!_pub.publish_loopback(response_message)) {}
+        Announcement requester;
+
+        requester.client_name       = request->discovery_request.client_name;
+        requester.client_session    = request->header.client_session;
+        requester.client_generation = request->header.client_generation;
+        requester.sequence          = request->header.sequence;
+        requester.next_slot         = 0;
+        requester.failures          = 0;
+        requester.due    = core::os::Time::now();
+        requester.active = true;
+
+        // An empty name asks for all the servers (see open_all): they are announced one at a time by announce()
+        if (request->discovery_request.rpc_name == "") {
+            Announcement* free = nullptr;
+
+            for (Announcement& announcement : _announcements) {
+                if (announcement.active && (announcement.client_name == requester.client_name)) {
+                    // A repeated request: the ongoing answer covers it
+                    free = nullptr;
+                    break;
                 }
+
+                if (!announcement.active && (free == nullptr)) {
+                    free = &announcement;
+                }
+            }
+
+            if (free != nullptr) {
+                *free = requester;
             }
+
+            _sub.release(*message);
+
+            return true;
+        }
+
+        SessionId  server_session    = 0;
+        Generation server_generation = 0;
+
+        {
+            core::os::ScopedLock<core::os::Mutex> lock(_lock);
+
+            for (ServerBase& server : _servers) {
+                if (request->discovery_request.rpc_name == server._rpc_name) {
+                    // We have a server
+                    server_session    = server._id;
+                    server_generation = server._generation;
+                    break;
+                }
+            }
+        }
+
+        if (server_session != 0) {
+            sendDiscoverResponse(requester, server_session, server_generation, request->discovery_request.rpc_name);
         }
 
         _sub.release(*message);
@@ -732,22 +1560,122 @@ public:
         return true;
     } // processDiscoverRequest
 
+    bool
+    sendDiscoverResponse(
+        const Announcement& requester,
+        SessionId           server_session,
+        Generation          server_generation,
+        const RPCName&      rpc_name
+    )
+    {
+        RPCMessage* response;
+
+        if (!_pub.alloc(response)) {
+            return false;
+        }
+
+        response->header.type     = core::mw::rpc::MessageType::DISCOVER_RESPONSE;
+        response->header.sequence = requester.sequence;
+        response->header.target_module_name      = requester.client_name;
+        response->header.client_session          = requester.client_session;
+        response->header.client_generation       = requester.client_generation;
+        response->header.server_session          = server_session;
+        response->header.server_generation       = server_generation;
+        response->discovery_response.rpc_name    = rpc_name;
+        response->discovery_response.server_name = _name;
+
+        if (!_pub.publish_loopback(response)) {}
+
+        return true;
+    } // sendDiscoverResponse
+
+    /*! \brief Send the next DISCOVER_RESPONSE of the pending RPC::open_all() requests
+     *
+     * Runs on the dispatcher, between the incoming messages, so that the responses are spaced
+     * by CORE_RPC_DISCOVERY_GAP_MS without stalling the other RPC traffic.
+     * The servers are walked through the session table, under the lock, one at a time.
+     *
+     * \retval true some responses are still to be sent
+     */
+    bool
+    announce()
+    {
+        core::os::Time now     = core::os::Time::now();
+        bool           pending = false;
+
+        for (Announcement& announcement : _announcements) {
+            if (!announcement.active) {
+                continue;
+            }
+
+            if (now < announcement.due) {
+                pending = true;
+                continue;
+            }
+
+            SessionId  server_session    = 0;
+            Generation server_generation = 0;
+            RPCName    rpc_name;
+
+            {
+                core::os::ScopedLock<core::os::Mutex> lock(_lock);
+
+                while ((announcement.next_slot < CORE_RPC_MAX_SERVERS) && (_server_table[announcement.next_slot] == nullptr)) {
+                    announcement.next_slot++;
+                }
+
+                if (announcement.next_slot < CORE_RPC_MAX_SERVERS) {
+                    const ServerBase& server = *_server_table[announcement.next_slot];
+
+                    server_session    = server._id;
+                    server_generation = server._generation;
+                    rpc_name = server._rpc_name;
+                }
+            }
+
+            if (server_session == 0) {
+                // All announced
+                announcement.active = false;
+                continue;
+            }
+
+            if (sendDiscoverResponse(announcement, server_session, server_generation, rpc_name)) {
+                announcement.next_slot++;
+                announcement.failures = 0;
+            } else if (++announcement.failures >= CORE_RPC_DISCOVERY_ROUNDS) {
+                // Our publisher pool is exhausted: give up on this server
+                announcement.next_slot++;
+                announcement.failures = 0;
+            }
+
+            announcement.due = now + core::os::Time::ms(CORE_RPC_DISCOVERY_GAP_MS);
+            pending = true;
+        }
+
+        return pending;
+    } // announce
+
     bool
     processDiscoverResponse(
         RPCMessage* message
     )
     {
-        for (ClientBase& client : _clients) {
-            if (message->header.client_session == client._id) {
-                // We have a client
-                if (message->header.sequence == client.transaction._sequence) {
-                    // We are doing the things in the right sequence
-                    if (message->header.target_module_name == _name) {
-                        // And, most important, the message is for us
-                        client.transaction._inbound_message = message;
-                        wake(client);
-                        return true;
-                    }
+        // Whoever asked, remember who serves what; answers to a bulk request only if we need them, as they can be many
+        if ((message->header.client_session != 0) || isWanted(message->discovery_response.rpc_name)) {
+            rememberServer(*message);
+        }
+
+        ClientBase* client = lookupClient(message->header.client_session, message->header.client_generation);
+
+        if (client != nullptr) {
+            // We have a client
+            if (message->header.sequence == client->transaction._sequence) {
+                // We are doing the things in the right sequence
+                if (message->header.target_module_name == _name) {
+                    // And, most important, the message is for us
+                    client->transaction._inbound_message = message;
+                    wake(*client);
+                    return true;
                 }
             }
         }
@@ -766,23 +1694,34 @@ public:
         RPCMessage* request = message;
 
         if (request->header.target_module_name == _name) {
-            for (ServerBase& server : _servers) {
-                if (request->header.server_session == server._id) {
-                    RPCMessage* response_message;
+            ServerBase* server;
+
+            {
+                // Queued or not, the request keeps the server from being removed until served
+                core::os::ScopedLock<core::os::Mutex> lock(_lock);
 
-                    if (_pub.alloc(response_message)) {
-                        RPCMessage* response = response_message;
-                        response->header.type               = core::mw::rpc::MessageType::RESPONSE;
-                        response->header.sequence           = request->header.sequence;
-                        response->header.client_session     = request->header.client_session;
-                        response->header.server_session     = request->header.server_session;
-                        response->header.target_module_name = _name;
+                server = lookupServer(request->header.server_session, request->header.server_generation);
 
-                        server.invoke(request->payload, response->payload);
+                if (server != nullptr) {
+                    server->_calls++;
+                }
+            }
 
-                        if (!_pub.publish_loopback(response_message)) {}
+            if (server != nullptr) {
+                if (server->_pooled && (_num_workers > 0)) {
+                    Job job = {
+                        server, message
+                    };
+
+                    if (_jobs.try_push(job)) {
+                        // The worker will release the message
+                        return true;
                     }
                 }
+
+                serve(*server, message);
+
+                return true;
             }
         }
 
@@ -791,33 +1730,89 @@ public:
         return true;
     } // processRequest
 
+    void
+    serve(
+        ServerBase& server,
+        RPCMessage* message
+    )
+    {
+        RPCMessage* request = message;
+        RPCMessage* response_message;
+
+        if (_pub.alloc(response_message)) {
+            RPCMessage* response = response_message;
+            response->header.type               = core::mw::rpc::MessageType::RESPONSE;
+            response->header.sequence           = request->header.sequence;
+            response->header.client_session     = request->header.client_session;
+            response->header.client_generation  = request->header.client_generation;
+            response->header.server_session     = request->header.server_session;
+            response->header.server_generation  = request->header.server_generation;
+            response->header.target_module_name = _name;
+
+            {
+                core::os::ScopedLock<core::os::Mutex> lock(server._invoke_lock);
+
+                server.invoke(request->payload, response->payload);
+            }
+
+            if (!_pub.publish_loopback(response_message)) {}
+        }
+
+        _sub.release(*message);
+
+        {
+            core::os::ScopedLock<core::os::Mutex> lock(_lock);
+
+            server._calls--;
+        }
+    } // serve
+
+    void
+    worker()
+    {
+        while (true) {
+            Job job;
+
+            _jobs.pop(job);
+
+            serve(*job.server, job.request);
+        }
+    } // worker
+
     bool
     processResponse(
         RPCMessage* message
     )
     {
-        for (ClientBase& client : _clients) {
-            if (message->header.client_session == client._id) {
-                // We have a client
-                if (message->header.sequence == client.transaction._sequence) {
-                    // We are doing the things in the right sequence
-                    if (message->header.server_session == client._server_id) {
-                        if (message->header.target_module_name == client._server_name) {
-                            client.transaction._inbound_message = message;
-
-                            if (client.transaction._timeout == core::os::Time::IMMEDIATE) {
-                                client.invoke();
-
-                                endClientTransaction(client);
-
-                                client._service = nullptr;
-                                client._state   = ClientBase::State::READY;
-                            } else {
-                                wake(client);
+        ClientBase* client = lookupClient(message->header.client_session, message->header.client_generation);
+
+        if (client != nullptr) {
+            // We have a client
+            if (message->header.sequence == client->transaction._sequence) {
+                // We are doing the things in the right sequence
+                if ((message->header.server_session == client->_server_id) && (message->header.server_generation == client->_server_generation)) {
+                    if (message->header.target_module_name == client->_server_name) {
+                        client->transaction._inbound_message = message;
+
+                        if (client->transaction._timeout == core::os::Time::IMMEDIATE) {
+#if CORE_RPC_STATS
+                            recordCall(*client, true, false);
+                            {
+                                core::os::SysLock::Scope lock;
+                                _stats.async_completions++;
                             }
+#endif
+                            client->invoke();
+
+                            endClientTransaction(*client);
 
-                            return true;
+                            client->_service = nullptr;
+                            client->_state   = ClientBase::State::READY;
+                        } else {
+                            wake(*client);
                         }
+
+                        return true;
                     }
                 }
             }
@@ -838,9 +1833,15 @@ public:
         _running = true;
         _sub_node.set_enabled(true);
 
+        bool announcing = false;
+
         while (true) {
             RPCMessage* message = nullptr;
 
+            // Wait for the messages instead of polling, and drain them back to back: they can come in bursts.
+            // While announcing, wake up in time for the next DISCOVER_RESPONSE
+            _sub_node.spin(announcing ? core::os::Time::ms(CORE_RPC_DISCOVERY_GAP_MS) : core::os::Time::ms(100));
+
             while (_sub.fetch(message)) {
                 switch (message->header.type) {
                   case MessageType::DISCOVER_REQUEST:
@@ -858,10 +1859,9 @@ public:
                   default:
                       break;
                 }
-                core::os::Thread::sleep(core::os::Time::ms(10));
             }
 
-            core::os::Thread::sleep(core::os::Time::ms(100));
+            announcing = announce();
         }
     } // thread
 
@@ -869,62 +1869,196 @@ public:
         return _running;
     }
 
+protected:
+    ServerBase*
+    findLocalServer(
+        const core::ConstString<RPCName::SIZE>& rpc_name
+    )
+    {
+        core::os::ScopedLock<core::os::Mutex> lock(_lock);
+
+        return findLocalServer_unsafe(rpc_name);
+    }
+
+    bool
+    isWanted(
+        const RPCName& rpc_name
+    )
+    {
+        core::os::ScopedLock<core::os::Mutex> lock(_lock);
+
+        for (ClientBase& client : _clients) {
+            if (rpc_name == client._rpc_name) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
 private:
+    struct Job {
+        ServerBase* server;
+        RPCMessage* request;
+    };
+
     core::os::Thread* _runner;
     bool _running;
 
-    uint8_t _next_client_id;
-    uint8_t _next_server_id;
+    Job _jobs_buf[CORE_RPC_WORKER_QUEUE_LENGTH];
+    LockedArrayQueue<Job> _jobs;
+    std::size_t _num_workers;
+
+    std::size_t _next_client_id;
+    std::size_t _next_server_id;
     StaticList<ClientBase> _clients;
     StaticList<ServerBase> _servers;
 
+    // Session tables: session id N lives in slot N - 1, 0 is not a valid session
+    ClientBase* _client_table[CORE_RPC_MAX_CLIENTS];
+    Generation  _client_generations[CORE_RPC_MAX_CLIENTS];
+    ServerBase* _server_table[CORE_RPC_MAX_SERVERS];
+    Generation  _server_generations[CORE_RPC_MAX_SERVERS];
+    Generation  _generation_seed;
+    bool        _seeded;
+
+    Announcement _announcements[CORE_RPC_DISCOVERY_ANNOUNCEMENTS];
+
+    static_assert(CORE_RPC_MAX_CLIENTS < 0xFFFF, "CORE_RPC_MAX_CLIENTS too big for SessionId");
+    static_assert(CORE_RPC_MAX_SERVERS < 0xFFFF, "CORE_RPC_MAX_SERVERS too big for SessionId");
+
 private:
-    uint8_t
-    getNextClientId()
+    ServerBase*
+    findLocalServer_unsafe(
+        const core::ConstString<RPCName::SIZE>& rpc_name
+    )
     {
-        // The following must be simple enough
-        bool found;
+        for (ServerBase& server : _servers) {
+            if (server._rpc_name == rpc_name) {
+                return &server;
+            }
+        }
 
-        do {
-            found = false;
+        return nullptr;
+    }
 
-            while ((++_next_client_id) == 0) {
-                /* get next id, avoiding 0 */
-            }
+    bool
+    allCached()
+    {
+        core::os::ScopedLock<core::os::Mutex> lock(_lock);
 
-            for (const ClientBase& client : _clients) {
-                if (client._id == _next_client_id) {
-                    found = true;
-                    break;
+        for (ClientBase& client : _clients) {
+            bool found = (client._state != ClientBase::State::NONE) || (findLocalServer_unsafe(client._rpc_name) != nullptr);
+
+            if (!found) {
+                core::os::ScopedLock<core::os::Mutex> cache_lock(_cache_lock);
+
+                core::os::Time now = core::os::Time::now();
+
+                for (const CachedServer& entry : _cache) {
+                    if (isFresh(entry, now) && (entry.rpc_name == client._rpc_name)) {
+                        found = true;
+                        break;
+                    }
                 }
             }
-        } while (found);
 
-        return _next_client_id;
-    } // getNextClientId
+            if (!found) {
+                return false;
+            }
+        }
 
-    uint8_t
-    getNextServerId()
+        return true;
+    } // allCached
+
+    ClientBase*
+    lookupClient(
+        SessionId  id,
+        Generation generation
+    ) const
     {
-        // The following must be simple enough
-        bool found;
+        if ((id == 0) || (id > CORE_RPC_MAX_CLIENTS)) {
+            return nullptr;
+        }
+
+        ClientBase* client = _client_table[id - 1];
+
+        if ((client == nullptr) || (client->_generation != generation)) {
+            // Stale or bogus session
+            return nullptr;
+        }
+
+        return client;
+    } // lookupClient
 
-        do {
-            found = false;
+    ServerBase*
+    lookupServer(
+        SessionId  id,
+        Generation generation
+    ) const
+    {
+        if ((id == 0) || (id > CORE_RPC_MAX_SERVERS)) {
+            return nullptr;
+        }
 
-            while ((++_next_server_id) == 0) {
-                /* get next id, avoiding 0 */
+        ServerBase* server = _server_table[id - 1];
+
+        if ((server == nullptr) || (server->_generation != generation)) {
+            // Stale or bogus session
+            return nullptr;
+        }
+
+        return server;
+    } // lookupServer
+
+    /*! \brief Generation for a new session in a slot
+     *
+     * Generations are offset by a per boot seed, so that a message sent to a session before a reboot
+     * does not match the session that takes the same slot after it.
+     */
+    Generation
+    nextGeneration(
+        Generation& counter
+    )
+    {
+        if (!_seeded) {
+            uint32_t seed = static_cast<uint32_t>(CORE_RPC_GENERATION_SEED());
+
+            _generation_seed = static_cast<Generation>(seed ^ (seed >> 8) ^ (seed >> 16) ^ (seed >> 24));
+            _seeded = true;
+        }
+
+        return static_cast<Generation>(++counter + _generation_seed);
+    } // nextGeneration
+
+    SessionId
+    getNextClientId()
+    {
+        // Round robin over the free slots, so that a session id is not reused immediately
+        for (std::size_t i = 0; i < CORE_RPC_MAX_CLIENTS; i++) {
+            _next_client_id = (_next_client_id + 1) % CORE_RPC_MAX_CLIENTS;
+
+            if (_client_table[_next_client_id] == nullptr) {
+                return static_cast<SessionId>(_next_client_id + 1);
             }
+        }
 
-            for (const ServerBase& server : _servers) {
-                if (server._id == _next_server_id) {
-                    found = true;
-                    break;
-                }
+        return 0;
+    } // getNextClientId
+
+    SessionId
+    getNextServerId()
+    {
+        // Round robin over the free slots, so that a session id is not reused immediately
+        for (std::size_t i = 0; i < CORE_RPC_MAX_SERVERS; i++) {
+            _next_server_id = (_next_server_id + 1) % CORE_RPC_MAX_SERVERS;
+
+            if (_server_table[_next_server_id] == nullptr) {
+                return static_cast<SessionId>(_next_server_id + 1);
             }
-        } while (found);
+        }
 
-        return _next_server_id;
+        return 0;
     } // getNextServerId
 };
 }
@@ -22,13 +22,25 @@ static const uint32_t RPC_NAME_LENGTH    = 24;
 
 using ModuleName = String<core::mw::NamingTraits<Middleware>::MAX_LENGTH>;
 using RPCName    = String<RPC_NAME_LENGTH>;
+using SessionId  = uint16_t;
+using Generation = uint8_t;
+
+/*! \brief Version of the RPC wire format
+ *
+ * Version 1: 8 bit sessions, 20 bytes header, 44 bytes payload.
+ * Version 2: 16 bit sessions and generations, 24 bytes header, 40 bytes payload.
+ *
+ * The version is part of the message type, so that modules running a different version
+ * drop each other's messages instead of misreading them.
+ */
+static const uint8_t RPC_PROTOCOL_VERSION = 2;
 
 enum class MessageType : uint8_t {
     NONE              = 0xFF,
-    DISCOVER_REQUEST  = 0x10,
-    DISCOVER_RESPONSE = 0x11,
-    REQUEST           = 0x20,
-    RESPONSE          = 0x21
+    DISCOVER_REQUEST  = 0x10 | ((RPC_PROTOCOL_VERSION - 1) << 1),
+    DISCOVER_RESPONSE = 0x11 | ((RPC_PROTOCOL_VERSION - 1) << 1),
+    REQUEST           = 0x20 | ((RPC_PROTOCOL_VERSION - 1) << 1),
+    RESPONSE          = 0x21 | ((RPC_PROTOCOL_VERSION - 1) << 1)
 };
 
 class RPCMessage:
@@ -37,9 +49,11 @@ class RPCMessage:
 public:
     struct Header {
         MessageType type;
-        uint8_t     client_session;
-        uint8_t     server_session;
         uint8_t     sequence;
+        SessionId   client_session;
+        SessionId   server_session;
+        Generation  client_generation;
+        Generation  server_generation;
         ModuleName  target_module_name;
     }
 
@@ -60,6 +74,8 @@ public:
     CORE_PACKED;
 
 
+    static_assert(sizeof(Header) == 24, "RPC header does not match RPC_PROTOCOL_VERSION");
+
     static const std::size_t PAYLOAD_SIZE = RPC_MESSAGE_LENGTH - sizeof(Header);
 
     Header header;
@@ -0,0 +1,133 @@
+/* COPYRIGHT (c) 2016-2018 Nova Labs SRL
+ *
+ * All rights reserved. All use of this software and documentation is
+ * subject to the License Agreement located in the file LICENSE.
+ */
+
+#pragma once
+
+#include <core/mw/namespace.hpp>
+#include <core/common.hpp>
+
+#include <core/os/Thread.hpp>
+
+#if !defined(CORE_STACK_PROFILER) || defined(__DOXYGEN__)
+#define CORE_STACK_PROFILER 0
+#endif
+
+#if !defined(CORE_STACK_PROFILER_LENGTH) || defined(__DOXYGEN__)
+#define CORE_STACK_PROFILER_LENGTH 16
+#endif
+
+NAMESPACE_CORE_MW_BEGIN
+
+/*! \brief Thread stack usage profiler
+ *
+ * Threads created through the profiler get their working area painted with a known pattern before they start.
+ * The high-water mark is then found by looking for the first word of the stack that has been overwritten.
+ *
+ * When CORE_STACK_PROFILER is 0, threads are created as usual, and no thread is profiled.
+ *
+ * \note With the profiler enabled, heap threads get their working area allocated by the profiler, and
+ * the thread is created as a static one. It must be handed back with release() after the thread has been joined.
+ */
+class StackProfiler
+{
+public:
+    struct Usage {
+        const char* name; //!< name of the thread
+        std::size_t size; //!< size of the working area [bytes]
+        std::size_t used; //!< high-water mark [bytes], including the thread descriptor
+    };
+
+    /*! \brief Create a thread with a profiled working area allocated from the heap
+     *
+     * \see core::os::Thread::create_heap
+     */
+    static core::os::Thread*
+    create_heap(
+        std::size_t                size,
+        core::os::Thread::Priority priority,
+        core::os::Thread::Function function,
+        void*                      arg,
+        const char*                name
+    );
+
+    /*! \brief Create a thread with a profiled, user provided, working area
+     *
+     * \see core::os::Thread::create_static
+     */
+    static core::os::Thread*
+    create_static(
+        void*                      stack,
+        std::size_t                size,
+        core::os::Thread::Priority priority,
+        core::os::Thread::Function function,
+        void*                      arg,
+        const char*                name
+    );
+
+    /*! \brief Stop profiling a thread
+     *
+     * The working area is freed, if it was allocated by create_heap().
+     *
+     * \pre The thread has terminated.
+     */
+    static void
+    release(
+        core::os::Thread* thread
+    );
+
+    /*! \brief Number of profiled threads
+     */
+    static std::size_t
+    count();
+
+    /*! \brief Stack usage of a profiled thread
+     *
+     * \retval true i is a valid index
+     */
+    static bool
+    usage(
+        std::size_t i,
+        Usage&      usage
+    );
+
+private:
+    static const uint32_t PATTERN = 0x55555555;
+
+    struct Entry {
+        core::os::Thread* thread;
+        const char*       name;
+        uint32_t*         stack;
+        std::size_t       size;
+        bool              owned;
+    };
+
+    static bool
+    add(
+        core::os::Thread* thread,
+        const char*       name,
+        uint32_t*         stack,
+        std::size_t       size,
+        bool              owned
+    );
+
+    static void
+    paint(
+        uint32_t*   stack,
+        std::size_t size
+    );
+
+    static std::size_t
+    unused(
+        const uint32_t* stack,
+        std::size_t     size
+    );
+
+#if CORE_STACK_PROFILER
+    static Entry _entries[CORE_STACK_PROFILER_LENGTH];
+#endif
+};
+
+NAMESPACE_CORE_MW_END
@@ -0,0 +1,195 @@
+/* COPYRIGHT (c) 2016-2018 Nova Labs SRL
+ *
+ * All rights reserved. All use of this software and documentation is
+ * subject to the License Agreement located in the file LICENSE.
+ */
+
+#pragma once
+
+#include <core/mw/namespace.hpp>
+#include <core/common.hpp>
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#if !defined(CORE_STATIC_FUNCTION_SIZE) || defined(__DOXYGEN__)
+#define CORE_STATIC_FUNCTION_SIZE    (4 * sizeof(void*))
+#endif
+
+NAMESPACE_CORE_MW_BEGIN
+
+template <typename SIGNATURE, std::size_t SIZE = CORE_STATIC_FUNCTION_SIZE>
+class StaticFunction;
+
+/*! \brief Fixed capacity callable
+ *
+ * A replacement for std::function that never allocates: the target is stored inline,
+ * and it must fit in SIZE bytes (it is checked at compile time).
+ */
+template <typename R, typename ... ARGS, std::size_t SIZE>
+class StaticFunction<R(ARGS ...), SIZE>
+{
+public:
+    StaticFunction() : _invoke(nullptr), _manage(nullptr) {}
+
+    StaticFunction(
+        std::nullptr_t
+    ) : _invoke(nullptr), _manage(nullptr) {}
+
+    template <typename F, typename = typename std::enable_if<!std::is_same<typename std::decay<F>::type, StaticFunction>::value>::type>
+    StaticFunction(
+        F&& f
+    ) : _invoke(nullptr), _manage(nullptr)
+    {
+        assign(std::forward<F>(f));
+    }
+
+    StaticFunction(
+        const StaticFunction& other
+    ) : _invoke(nullptr), _manage(nullptr)
+    {
+        copy(other);
+    }
+
+    ~StaticFunction()
+    {
+        clear();
+    }
+
+    StaticFunction&
+    operator=(
+        const StaticFunction& other
+    )
+    {
+        if (this != &other) {
+            clear();
+            copy(other);
+        }
+
+        return *this;
+    }
+
+    StaticFunction&
+    operator=(
+        std::nullptr_t
+    )
+    {
+        clear();
+
+        return *this;
+    }
+
+    template <typename F, typename = typename std::enable_if<!std::is_same<typename std::decay<F>::type, StaticFunction>::value>::type>
+    StaticFunction&
+    operator=(
+        F&& f
+    )
+    {
+        clear();
+        assign(std::forward<F>(f));
+
+        return *this;
+    }
+
+    R
+    operator()(
+        ARGS ... args
+    ) const
+    {
+        CORE_ASSERT(_invoke != nullptr);
+
+        return _invoke(&_storage, std::forward<ARGS>(args) ...);
+    }
+
+    explicit
+    operator bool() const
+    {
+        return _invoke != nullptr;
+    }
+
+private:
+    enum class Operation {
+        COPY, DESTROY
+    };
+
+    using Storage = typename std::aligned_storage<SIZE, alignof(std::max_align_t)>::type;
+    using Invoker = R (*)(void*, ARGS&& ...);
+    using Manager = void (*)(Operation, void*, const void*);
+
+    mutable Storage _storage;
+    Invoker         _invoke;
+    Manager         _manage;
+
+    template <typename F>
+    void
+    assign(
+        F&& f
+    )
+    {
+        using Target = typename std::decay<F>::type;
+
+        static_assert(sizeof(Target) <= SIZE, "sizeof(F) > SIZE");
+        static_assert(alignof(Target) <= alignof(Storage), "alignof(F) > alignof(Storage)");
+
+        new (&_storage) Target(std::forward<F>(f));
+
+        _invoke = &invoke_<Target>;
+        _manage = &manage_<Target>;
+    }
+
+    void
+    copy(
+        const StaticFunction& other
+    )
+    {
+        if (other._manage != nullptr) {
+            other._manage(Operation::COPY, &_storage, &other._storage);
+        }
+
+        _invoke = other._invoke;
+        _manage = other._manage;
+    }
+
+    void
+    clear()
+    {
+        if (_manage != nullptr) {
+            _manage(Operation::DESTROY, &_storage, nullptr);
+        }
+
+        _invoke = nullptr;
+        _manage = nullptr;
+    }
+
+    template <typename Target>
+    static R
+    invoke_(
+        void* target,
+        ARGS&& ... args
+    )
+    {
+        return (*reinterpret_cast<Target*>(target))(std::forward<ARGS>(args) ...);
+    }
+
+    template <typename Target>
+    static void
+    manage_(
+        Operation   operation,
+        void*       target,
+        const void* source
+    )
+    {
+        switch (operation) {
+          case Operation::COPY:
+              new (target) Target(*reinterpret_cast<const Target*>(source));
+              break;
+          case Operation::DESTROY:
+              reinterpret_cast<Target*>(target)->~Target();
+              break;
+        }
+    }
+};
+
+NAMESPACE_CORE_MW_END
@@ -35,6 +35,11 @@ class Topic:
 private:
     const char* const     namep;
     core::os::Time        publish_timeout;
+    /*! \brief Message buffers of the topic
+     *
+     * Sized to the exact number of publisher and queue slots (see extend_pool()): there is no per-thread cache
+     * in front of it, as buffers parked in an idle thread would make other allocations fail.
+     */
     core::os::MemoryPool_ msg_pool;
     size_t num_local_publishers;
     size_t num_remote_publishers;
@@ -155,6 +160,13 @@ public:
         MessageType*& msgp
     );
 
+    /*! \brief Drop a reference to a message, and free it if it was the last one
+     *
+     * Reference and pool are updated within the same critical section:
+     * prefer it to Message::release() followed by free().
+     *
+     * \retval true the message has been freed
+     */
     bool
     release(
         Message& msg
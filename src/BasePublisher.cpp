@@ -82,9 +82,7 @@ BasePublisher::publish(
     success = topicp->notify_locals(msg, now, mustReschedule);
     success = topicp->notify_remotes(msg, now) && success;
 
-    if (!msg.release()) {
-        topicp->free(msg);
-    }
+    topicp->release(msg);
 
     return success;
 }
@@ -104,9 +102,7 @@ BasePublisher::publish_loopback(
     success = topicp->notify_locals_loopback(msg, now, mustReschedule);
     success = topicp->notify_remotes(msg, now) && success;
 
-    if (!msg.release()) {
-        topicp->free(msg);
-    }
+    topicp->release(msg);
 
     return success;
 }
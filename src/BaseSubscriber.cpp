@@ -34,12 +34,8 @@ BaseSubscriber::release(
 {
     CORE_ASSERT(topicp != nullptr);
 
-    if (!msg.release()) {
-        topicp->free(msg);
-        return false;
-    }
-
-    return true;
+    // One critical section, for both the reference and the pool
+    return !topicp->release(msg);
 }
 
 BaseSubscriber::BaseSubscriber()
@@ -5,6 +5,8 @@
  */
 
 #include <core/mw/BootloaderMaster.hpp>
+#include <core/mw/StackProfiler.hpp>
+#include <core/mw/Checksummer.hpp>
 
 NAMESPACE_CORE_MW_BEGIN
 
@@ -64,8 +66,18 @@ BootloaderMaster::BootloaderMaster() : _node("bootm", false),
     _masterThread(nullptr),
     _run(true),
     _advertise(true),
-    _bootload(true), _ack_filter(MessageType::NONE), _sequence_id(0), _command(nullptr), _selected(0), _runner(nullptr)
-{}
+    _bootload(true), _ack_filter(MessageType::NONE), _sequence_id(0), _command(nullptr), _selected(0), _runner(nullptr),
+    _window_event(false), _window_runner(nullptr), _blocks(0), _ihex_base(0), _group_size(0),
+    _bulk_buffer(nullptr), _bulk_offset(0), _bulk_length(0), _bulk_received(0), _bulk_status(AcknowledgeStatus::NONE)
+{
+    for (WindowSlot& slot : _window) {
+        slot.state = WindowSlot::State::FREE;
+    }
+
+    _staging.length = 0;
+
+    resetStatistics();
+}
 
 bool
 BootloaderMaster::masterAdvertiseNode()
@@ -110,7 +122,7 @@ BootloaderMaster::masterAdvertiseNode()
                            }
                        };
 
-    auto tmp = core::os::Thread::create_heap(nullptr, 128, core::os::Thread::PriorityEnum::LOWEST, thread_code, this, "bootm_adv");
+    auto tmp = StackProfiler::create_heap(128, core::os::Thread::PriorityEnum::LOWEST, thread_code, this, "bootm_adv");
 
     if (tmp == nullptr) {
         return false;
@@ -123,6 +135,18 @@ BootloaderMaster::masterAdvertiseNode()
     return true;
 } // BootloaderMaster::masterAdvertiseNode
 
+void
+BootloaderMaster::resetStatistics()
+{
+    _statistics.commands = 0;
+    _statistics.timeouts = 0;
+    _statistics.blocks   = 0;
+    _statistics.resent   = 0;
+    _statistics.bytes    = 0;
+    _statistics.start    = core::os::Time::now();
+    _statistics.last     = _statistics.start;
+}
+
 std::size_t
 BootloaderMaster::slavesCount() const
 {
@@ -136,7 +160,12 @@ BootloaderMaster::waitForAck(
 {
     _last_ack.status = AcknowledgeStatus::NONE;
 
-    return wait(timeout);
+    if (!wait(timeout)) {
+        _statistics.timeouts++;
+        return false;
+    }
+
+    return true;
 }
 
 void
@@ -149,24 +178,33 @@ BootloaderMaster::masterNodeCode()
     _node.set_enabled(true);
 
     while (_run) {
-        if (_sub.fetch(msgp)) {
-            if (msgp->command == MessageType::ACK) {
-                const AcknowledgeMsg* tmp = reinterpret_cast<const AcknowledgeMsg*>(msgp);
-
-                if (tmp->type == _ack_filter) {
-                    if (tmp->sequenceId == _sequence_id + 1) {
-                        memcpy(&_last_ack, tmp, BootMsg::MESSAGE_LENGTH);
-                        _sequence_id = tmp->sequenceId + 1;
-                        _ack_filter  = MessageType::NONE;
-                        wake();
+        // Wait for the acks instead of polling: with a window of blocks in flight, they come back to back
+        if (_node.spin(core::os::Time::ms(100))) {
+            while (_sub.fetch(msgp)) {
+                if (msgp->command == MessageType::ACK) {
+                    const AcknowledgeMsg* tmp = reinterpret_cast<const AcknowledgeMsg*>(msgp);
+
+                    _statistics.last = core::os::Time::now();
+
+                    if (tmp->type == MessageType::BLOCK_WRITE) {
+                        acknowledgeBlock(*tmp);
+                    } else if (tmp->type == MessageType::TAGS_READ_BULK) {
+                        acknowledgeChunk(*tmp);
+                    } else if (tmp->type == _ack_filter) {
+                        if (tmp->sequenceId == _sequence_id + 1) {
+                            memcpy(&_last_ack, tmp, BootMsg::MESSAGE_LENGTH);
+                            _sequence_id = tmp->sequenceId + 1;
+                            _ack_filter  = MessageType::NONE;
+                            wake();
+                        }
                     }
+                } else if (msgp->command == MessageType::DESCRIPTION) {
+                    description(*msgp);
                 }
-            }
 
-            _sub.release(*msgp);
+                _sub.release(*msgp);
+            }
         }
-
-        core::os::Thread::sleep(core::os::Time::ms(10));
     }
 } // BootloaderMaster::masterNodeCode
 
@@ -180,7 +218,7 @@ BootloaderMaster::masterNode()
                            _this->masterNodeCode();
                        };
 
-    auto tmp = core::os::Thread::create_heap(nullptr, 1024, core::os::Thread::PriorityEnum::NORMAL, thread_code, this, "bootm_sub");
+    auto tmp = StackProfiler::create_heap(1024, core::os::Thread::PriorityEnum::NORMAL, thread_code, this, "bootm_sub");
 
     if (tmp == nullptr) {
         return false;
@@ -216,7 +254,7 @@ BootloaderMaster::masterAnnounceNode()
 
 					                    core::os::SysLock::Scope lock;
 
-                                       _this->_slaves[tmp->uid];
+                                       _this->_slaves[tmp->uid]._announced_version = tmp->version;
                                    }
 
                                    sub.release(*msgp);
@@ -226,7 +264,7 @@ BootloaderMaster::masterAnnounceNode()
                            }
                        };
 
-    auto tmp = core::os::Thread::create_heap(nullptr, 256 + sizeof(core::mw::Subscriber<core::mw::bootloader::BootMasterMsg, MAX_NUMBER_OF_SLAVES>), core::os::Thread::PriorityEnum::NORMAL - 1, thread_code, this, "bootm_sub");
+    auto tmp = StackProfiler::create_heap(256 + sizeof(core::mw::Subscriber<core::mw::bootloader::BootMasterMsg, MAX_NUMBER_OF_SLAVES>), core::os::Thread::PriorityEnum::NORMAL - 1, thread_code, this, "bootm_sub");
 
     if (tmp == nullptr) {
         return false;
@@ -295,6 +333,7 @@ BootloaderMaster::wait(
 
     _runner = &core::os::Thread::self();
     core::os::Thread::Return msg = core::os::Thread::sleep_timeout(timeout);
+    _runner = nullptr; // On timeout, a late ack must not wake a thread that is no longer waiting
 
     return msg == 0x1BADCAFE;
 }
@@ -336,8 +375,9 @@ BootloaderMaster::beginCommand(
 bool
 BootloaderMaster::endCommand()
 {
-    if (_pub.publish_remotely(*_command)) {
+    if (publish(*_command)) {
         _command = nullptr;
+        _statistics.commands++;
         return true;
     }
 
@@ -346,6 +386,18 @@ BootloaderMaster::endCommand()
     return false;
 }
 
+bool
+BootloaderMaster::publish(
+    BootMsg& msg
+)
+{
+#if BOOTLOADER_MASTER_LOCAL_SLAVES
+    return _pub.publish(msg);
+#else
+    return _pub.publish_remotely(msg);
+#endif
+}
+
 bool
 BootloaderMaster::commandUIDAndMaster(
     MessageType type,
@@ -526,6 +578,73 @@ BootloaderMaster::commandUIDAndAddress(
     return false;
 }
 
+bool
+BootloaderMaster::commandCompressedImage(
+    MessageType type,
+    ModuleUID   uid,
+    uint32_t    address,
+    uint32_t    length,
+    uint32_t    crc
+)
+{
+    if (beginCommand(type)) {
+        commandPayload<payload::CompressedImage>()->uid     = uid;
+        commandPayload<payload::CompressedImage>()->address = address;
+        commandPayload<payload::CompressedImage>()->length  = length;
+        commandPayload<payload::CompressedImage>()->crc     = crc;
+
+        if (endCommand()) {
+            if (waitForAck()) {
+                return _last_ack.status == AcknowledgeStatus::OK;
+            }
+        }
+    }
+
+    return false;
+}
+
+bool
+BootloaderMaster::commandUIDAndIndex(
+    MessageType type,
+    ModuleUID   uid,
+    uint16_t    index
+)
+{
+    if (beginCommand(type)) {
+        commandPayload<payload::UIDAndIndex>()->uid   = uid;
+        commandPayload<payload::UIDAndIndex>()->index = index;
+
+        if (endCommand()) {
+            if (waitForAck()) {
+                return _last_ack.status == AcknowledgeStatus::OK;
+            }
+        }
+    }
+
+    return false;
+}
+
+bool
+BootloaderMaster::commandUIDAndCount(
+    MessageType type,
+    ModuleUID   uid,
+    uint16_t    count
+)
+{
+    if (beginCommand(type)) {
+        commandPayload<payload::UIDAndCount>()->uid   = uid;
+        commandPayload<payload::UIDAndCount>()->count = count;
+
+        if (endCommand()) {
+            if (waitForAck()) {
+                return _last_ack.status == AcknowledgeStatus::OK;
+            }
+        }
+    }
+
+    return false;
+}
+
 bool
 BootloaderMaster::selectSlave(
     ModuleUID uid
@@ -547,24 +666,25 @@ BootloaderMaster::ls()
 {
     bool success = true;
 
+    describeAll(core::os::Time::ms(BOOTLOADER_MASTER_DESCRIBE_ALL_MS));
+
     size_t n = slavesCount();
 
     for(size_t i = 0; i < n; i++) {
+        SlaveDescription& slave = _slaves.value(i);
+
+        if (slave._described) {
+            continue;
+        }
+
         bool      tmp = true;
         ModuleUID uid = _slaves.key(i);
         tmp &= selectSlave(uid);
 
         if(!tmp) {
-        	_slaves.value(i)._version = SlaveDescription::Version::NONE;
-    	} else if(describeV3(_slaves.value(i)._v3)) {
-    		_slaves.value(i)._version = SlaveDescription::Version::V3;
-        } else if(describeV2(_slaves.value(i)._v2)) {
-        	_slaves.value(i)._version = SlaveDescription::Version::V2;
-        } else if(describeV1(_slaves.value(i)._v1)) {
-        	_slaves.value(i)._version = SlaveDescription::Version::V1;
+        	slave._version = SlaveDescription::Version::NONE;
         } else {
-        	_slaves.value(i)._version = SlaveDescription::Version::NONE;
-        	tmp = false;
+            tmp = describe(slave);
         }
 
         deselectSlave();
@@ -577,6 +697,117 @@ BootloaderMaster::ls()
     return success;
 } // BootloaderMaster::ls
 
+bool
+BootloaderMaster::describeAll(
+    core::os::Time timeout
+)
+{
+    {
+        core::os::SysLock::Scope lock;
+
+        for (std::size_t i = 0; i < _slaves.size(); i++) {
+            _slaves.value(i)._described = false;
+        }
+    }
+
+    if (!beginCommand(MessageType::DESCRIBE_ALL) || !endCommand()) {
+        return false;
+    }
+
+    _ack_filter = MessageType::NONE; // Answers are DESCRIPTION messages, collected by masterNodeCode()
+
+    core::os::Time start = core::os::Time::now();
+
+    while (core::os::Time::now() - start < timeout) {
+        bool all = true;
+
+        {
+            core::os::SysLock::Scope lock;
+
+            for (std::size_t i = 0; i < _slaves.size(); i++) {
+                all &= _slaves.value(i)._described;
+            }
+        }
+
+        if (all) {
+            break;
+        }
+
+        core::os::Thread::sleep(core::os::Time::ms(10));
+    }
+
+    return true;
+} // BootloaderMaster::describeAll
+
+void
+BootloaderMaster::description(
+    const BootMsg& msg
+)
+{
+    static_assert(sizeof(payload::Description) <= BootMsg::DATA_LENGTH, "Description too large");
+
+    CORE_WARNINGS_NO_CAST_ALIGN
+    const payload::Description* tmp = reinterpret_cast<const payload::Description*>(&msg.data);
+    CORE_WARNINGS_RESET
+
+    core::os::SysLock::Scope lock;
+
+    SlaveDescription& slave = _slaves[tmp->uid];
+
+    slave._v3        = tmp->description;
+    slave._version   = SlaveDescription::Version::V3;
+    slave._described = true;
+}
+
+bool
+BootloaderMaster::describe(
+    SlaveDescription& slave
+)
+{
+    // Each wrong guess costs a timeout: start from the version that worked last time, or from the announced one
+    SlaveDescription::Version hint = slave._version;
+
+    if ((hint == SlaveDescription::Version::NONE) && (slave._announced_version >= 1) && (slave._announced_version <= 3)) {
+        hint = static_cast<SlaveDescription::Version>(slave._announced_version);
+    }
+
+    const SlaveDescription::Version order[] = {
+        hint, SlaveDescription::Version::V3, SlaveDescription::Version::V2, SlaveDescription::Version::V1
+    };
+
+    for (std::size_t i = 0; i < 4; i++) {
+        bool success = false;
+
+        if ((i > 0) && (order[i] == hint)) {
+            continue;
+        }
+
+        switch (order[i]) {
+          case SlaveDescription::Version::V3:
+              success = describeV3(slave._v3);
+              break;
+          case SlaveDescription::Version::V2:
+              success = describeV2(slave._v2);
+              break;
+          case SlaveDescription::Version::V1:
+              success = describeV1(slave._v1);
+              break;
+          default:
+              break;
+        }
+
+        if (success) {
+            slave._version   = order[i];
+            slave._described = true;
+            return true;
+        }
+    }
+
+    slave._version = SlaveDescription::Version::NONE;
+
+    return false;
+} // BootloaderMaster::describe
+
 void
 BootloaderMaster::clear()
 {
@@ -656,6 +887,7 @@ BootloaderMaster::resetAllSlaves()
 void
 BootloaderMaster::deselectAllSlaves()
 {
+	_group_size = 0;
 	_selected = 0xFFFFFFFF;
 	selectSlave(_selected);
 	_selected = 0xFFFFFFFF;
@@ -715,6 +947,31 @@ BootloaderMaster::writeProgramCRC(
     return commandUIDAndCRC(MessageType::WRITE_PROGRAM_CRC, _selected, crc);
 }
 
+static bool
+hex_byte(
+    const char* string,
+    uint8_t&    value
+)
+{
+    value = 0;
+
+    for (std::size_t i = 0; i < 2; i++) {
+        char c = string[i];
+
+        if ((c >= '0') && (c <= '9')) {
+            value = (value << 4) | (c - '0');
+        } else if ((c >= 'A') && (c <= 'F')) {
+            value = (value << 4) | (c - 'A' + 10);
+        } else if ((c >= 'a') && (c <= 'f')) {
+            value = (value << 4) | (c - 'a' + 10);
+        } else {
+            return false; // Also stops at the terminator
+        }
+    }
+
+    return true;
+}
+
 bool
 BootloaderMaster::beginIHex()
 {
@@ -726,8 +983,18 @@ BootloaderMaster::writeIHex(
     const char* ihex_string
 )
 {
-    return commandIHex(MessageType::IHEX_WRITE, payload::IHex::Type::DATA, ihex_string);
-}
+    uint8_t length;
+
+    if (!commandIHex(MessageType::IHEX_WRITE, payload::IHex::Type::DATA, ihex_string)) {
+        return false;
+    }
+
+    if (hex_byte(ihex_string + 1, length)) {
+        _statistics.bytes += length;
+    }
+
+    return true;
+} // BootloaderMaster::writeIHex
 
 bool
 BootloaderMaster::endIHex()
@@ -735,10 +1002,769 @@ BootloaderMaster::endIHex()
     return commandIHex(MessageType::IHEX_WRITE, payload::IHex::Type::END, "");
 }
 
+void
+BootloaderMaster::acknowledgeBlock(
+    const AcknowledgeMsg& ack
+)
+{
+    CORE_WARNINGS_NO_CAST_ALIGN
+    const AcknowledgeBlock* tmp = reinterpret_cast<const AcknowledgeBlock*>(&ack);
+    CORE_WARNINGS_RESET
+
+    core::os::SysLock::Scope lock;
+
+    for (WindowSlot& slot : _window) {
+        if ((slot.state == WindowSlot::State::PENDING) && (slot.block.index == tmp->data.index)) {
+            // Anything but OK gets the block sent again, without waiting for its timeout
+            slot.state    = (ack.status == AcknowledgeStatus::OK) ? WindowSlot::State::FREE : WindowSlot::State::NACKED;
+            _window_event = true;
+
+            if (_window_runner != nullptr) {
+                core::os::Thread::wake(*(_window_runner), 0x1BADCAFE);
+                _window_runner = nullptr;
+            }
+
+            break;
+        }
+    }
+} // BootloaderMaster::acknowledgeBlock
+
+void
+BootloaderMaster::waitForBlockAck(
+    core::os::Time timeout
+)
+{
+    core::os::SysLock::Scope lock;
+
+    if (!_window_event) {
+        _window_runner = &core::os::Thread::self();
+        core::os::Thread::sleep_timeout(timeout);
+        _window_runner = nullptr;
+    }
+
+    _window_event = false;
+}
+
+bool
+BootloaderMaster::sendBlock(
+    const payload::Block& block
+)
+{
+    core::mw::bootloader::BootMsg* msgp;
+
+    if (_pub.alloc(msgp)) {
+        msgp->command    = MessageType::BLOCK_WRITE;
+        msgp->sequenceId = _sequence_id;
+        memcpy(msgp->data, &block, sizeof(block));
+
+        if (publish(*msgp)) {
+            _statistics.blocks++;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool
+BootloaderMaster::serviceWindow(
+    core::os::Time& timeout
+)
+{
+    const core::os::Time BLOCK_TIMEOUT = core::os::Time::ms(BOOTLOADER_MASTER_BLOCK_TIMEOUT_MS);
+    core::os::Time       now = core::os::Time::now();
+
+    timeout = BLOCK_TIMEOUT;
+
+    for (WindowSlot& slot : _window) {
+        bool resend = false;
+
+        {
+            core::os::SysLock::Scope lock;
+
+            if ((slot.state == WindowSlot::State::NACKED) || ((slot.state == WindowSlot::State::PENDING) && (now - slot.sent >= BLOCK_TIMEOUT))) {
+                slot.state = WindowSlot::State::PENDING;
+                slot.sent  = now;
+                resend     = true;
+            } else if (slot.state == WindowSlot::State::PENDING) {
+                core::os::Time left = BLOCK_TIMEOUT - (now - slot.sent);
+
+                if (left < timeout) {
+                    timeout = left;
+                }
+            }
+        }
+
+        if (resend) {
+            if (slot.retries >= BOOTLOADER_MASTER_BLOCK_RETRIES) {
+                return false;
+            }
+
+            slot.retries++;
+            _statistics.resent++;
+
+            // A failed publish is handled as a lost block
+            sendBlock(slot.block);
+        }
+    }
+
+    return true;
+} // BootloaderMaster::serviceWindow
+
+bool
+BootloaderMaster::queueBlock()
+{
+    if (_staging.length == 0) {
+        return true;
+    }
+
+    _staging.index    = _blocks;
+    _staging.flags    = 0;
+
+    for (;;) {
+        core::os::Time timeout;
+
+        if (!serviceWindow(timeout)) {
+            return false;
+        }
+
+        // Only this thread takes a slot out of FREE, so there is no need to lock
+        for (WindowSlot& slot : _window) {
+            if (slot.state == WindowSlot::State::FREE) {
+                slot.block   = _staging;
+                slot.retries = 0;
+                slot.sent    = core::os::Time::now();
+
+                {
+                    core::os::SysLock::Scope lock;
+                    slot.state = WindowSlot::State::PENDING;
+                }
+
+                sendBlock(slot.block);
+
+                _statistics.bytes += slot.block.length;
+                _blocks++;
+                _staging.length = 0;
+
+                return true;
+            }
+        }
+
+        waitForBlockAck(timeout);
+    }
+} // BootloaderMaster::queueBlock
+
+bool
+BootloaderMaster::drainWindow()
+{
+    for (;;) {
+        core::os::Time timeout;
+
+        if (!serviceWindow(timeout)) {
+            return false;
+        }
+
+        bool empty = true;
+
+        for (const WindowSlot& slot : _window) {
+            empty &= (slot.state == WindowSlot::State::FREE);
+        }
+
+        if (empty) {
+            return true;
+        }
+
+        waitForBlockAck(timeout);
+    }
+}
+
+void
+BootloaderMaster::resetTransfer()
+{
+    for (WindowSlot& slot : _window) {
+        slot.state = WindowSlot::State::FREE;
+    }
+
+    _window_event   = false;
+    _staging.length = 0;
+    _blocks         = 0;
+    _ihex_base      = 0;
+}
+
+bool
+BootloaderMaster::beginProgram()
+{
+    resetTransfer();
+
+    return commandUID(MessageType::BLOCK_BEGIN, _selected);
+}
+
+bool
+BootloaderMaster::writeProgram(
+    uint32_t       address,
+    const uint8_t* data,
+    std::size_t    length
+)
+{
+    while (length > 0) {
+        if ((_staging.length > 0) && (address != _staging.address + _staging.length)) {
+            if (!queueBlock()) {
+                return false;
+            }
+        }
+
+        if (_staging.length == 0) {
+            _staging.address = address;
+        }
+
+        // Blocks do not cross a Block::SIZE boundary, and so never span two flash pages
+        std::size_t capacity = payload::Block::SIZE - (_staging.address % payload::Block::SIZE);
+        std::size_t n        = std::min(length, capacity - _staging.length);
+
+        memcpy(&_staging.data[_staging.length], data, n);
+        _staging.length += n;
+        address         += n;
+        data    += n;
+        length  -= n;
+
+        if (_staging.length == capacity) {
+            if (!queueBlock()) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+} // BootloaderMaster::writeProgram
+
+bool
+BootloaderMaster::writeProgram(
+    const char* ihex_string
+)
+{
+    // length, address (2), type, data, checksum
+    uint8_t record[1 + 2 + 1 + 255 + 1];
+
+    if ((ihex_string[0] != ':') || !hex_byte(ihex_string + 1, record[0])) {
+        return false;
+    }
+
+    std::size_t n   = 1 + 2 + 1 + record[0] + 1;
+    uint8_t     sum = record[0];
+
+    for (std::size_t i = 1; i < n; i++) {
+        if (!hex_byte(ihex_string + 1 + 2 * i, record[i])) {
+            return false;
+        }
+
+        sum += record[i];
+    }
+
+    if (sum != 0) {
+        return false;
+    }
+
+    uint32_t offset = (record[1] << 8) | record[2];
+    uint32_t value  = (record[4] << 8) | record[5];
+
+    switch (record[3]) {
+      case 0x00: // Data
+          return writeProgram(_ihex_base + offset, &record[4], record[0]);
+
+      case 0x02: // Extended segment address
+          _ihex_base = value << 4;
+          return record[0] == 2;
+
+      case 0x04: // Extended linear address
+          _ihex_base = value << 16;
+          return record[0] == 2;
+
+      case 0x01: // End of file
+      case 0x03: // Start segment address
+      case 0x05: // Start linear address
+          return true;
+
+      default:
+          return false;
+    } // switch
+} // BootloaderMaster::writeProgram
+
+/* CRC-32 of a flash page, once the image has been programmed into it.
+ */
+static uint32_t
+page_crc(
+    uint32_t       page,
+    std::size_t    page_size,
+    uint32_t       address,
+    const uint8_t* image,
+    std::size_t    length
+)
+{
+    uint32_t from = std::max(page, address);
+    uint32_t to   = std::min(static_cast<uint32_t>(page + page_size), static_cast<uint32_t>(address + length));
+    CRC32    crc;
+
+    crc.fill(0xFF, from - page);
+    crc.add(image + (from - address), to - from);
+    crc.fill(0xFF, page + page_size - to);
+
+    return crc.get();
+}
+
+bool
+BootloaderMaster::readPageCRC(
+    uint32_t          address,
+    payload::PageCRC& crcs
+)
+{
+    if (commandUIDAndAddress(MessageType::PAGE_CRC, _selected, address)) {
+        AcknowledgePageCRC* tmp = reinterpret_cast<AcknowledgePageCRC*>(&_last_ack);
+        crcs = tmp->data;
+
+        // The first page must hold the address, or writeProgramDiff() would not move forward
+        return (crcs.count > 0) && (crcs.count <= payload::PageCRC::MAX_COUNT) && (crcs.pageSize > 0)
+               && (crcs.address <= address) && (address - crcs.address < crcs.pageSize);
+    }
+
+    return false;
+}
+
+bool
+BootloaderMaster::writeProgramDiff(
+    uint32_t       address,
+    const uint8_t* image,
+    std::size_t    length,
+    std::size_t*   changed
+)
+{
+    const uint32_t end   = address + length;
+    uint32_t       next  = address;
+    std::size_t    pages = 0;
+
+    if (!beginProgram()) {
+        return false;
+    }
+
+    while (next < end) {
+        payload::PageCRC crcs;
+
+        if (!readPageCRC(next, crcs)) {
+            return false;
+        }
+
+        for (std::size_t i = 0; (i < crcs.count) && (next < end); i++) {
+            uint32_t page = crcs.address + i * crcs.pageSize;
+            uint32_t from = std::max(page, address);
+            uint32_t to   = std::min(static_cast<uint32_t>(page + crcs.pageSize), end);
+
+            if (page_crc(page, crcs.pageSize, address, image, length) != crcs.crc[i]) {
+                // Blocks of the previous pages can still be in flight: the slave handles messages in order
+                if (!commandUIDAndAddress(MessageType::ERASE_PAGE, _selected, page)) {
+                    return false;
+                }
+
+                if (!writeProgram(from, image + (from - address), to - from)) {
+                    return false;
+                }
+
+                pages++;
+            }
+
+            next = page + crcs.pageSize;
+        }
+    }
+
+    if (changed != nullptr) {
+        *changed = pages;
+    }
+
+    return endProgram();
+} // BootloaderMaster::writeProgramDiff
+
+bool
+BootloaderMaster::writeProgramCompressed(
+    uint32_t       address,
+    const uint8_t* image,
+    std::size_t    length,
+    LzEncoder&     encoder,
+    std::size_t*   compressed
+)
+{
+    uint32_t crc = CRC32::compute(image, length);
+
+    resetTransfer();
+
+    if (!commandCompressedImage(MessageType::BLOCK_BEGIN_COMPRESSED, _selected, address, length, crc)) {
+        return false;
+    }
+
+    uint8_t     chunk[payload::Block::SIZE];
+    uint32_t    offset = 0;
+    std::size_t n;
+
+    encoder.reset(image, length);
+
+    // Block addresses are offsets in the stream
+    while ((n = encoder.encode(chunk, sizeof(chunk))) > 0) {
+        if (!writeProgram(offset, chunk, n)) {
+            return false;
+        }
+
+        offset += n;
+    }
+
+    if (compressed != nullptr) {
+        *compressed = offset;
+    }
+
+    return endProgram();
+} // BootloaderMaster::writeProgramCompressed
+
+bool
+BootloaderMaster::endProgram()
+{
+    if (!queueBlock() || !drainWindow()) {
+        return false;
+    }
+
+    return commandUIDAndCount(MessageType::BLOCK_END, _selected, _blocks);
+}
+
+const SlaveDescription*
+BootloaderMaster::findSlave(
+    ModuleUID uid
+) const
+{
+    return _slaves.find(uid);
+}
+
+bool
+BootloaderMaster::selectGroup(
+    const ModuleUID* uids,
+    std::size_t      count
+)
+{
+    _group_size = 0;
+
+    if ((count == 0) || (count > MAX_NUMBER_OF_SLAVES)) {
+        return false;
+    }
+
+    // Only identical modules can share an image
+    const SlaveDescription* reference = findSlave(uids[0]);
+
+    for (std::size_t i = 0; i < count; i++) {
+        const SlaveDescription* description = findSlave(uids[i]);
+
+        if ((reference == nullptr) || (description == nullptr) || (description->version() == SlaveDescription::Version::NONE)) {
+            return false;
+        }
+
+        if (strncmp(description->moduleType().c_str(), reference->moduleType().c_str(), sizeof(ModuleType)) != 0) {
+            return false;
+        }
+    }
+
+    bool success = true;
+
+    // A slave stays selected until it is deselected: selecting the next one does not drop the previous ones
+    for (std::size_t i = 0; i < count; i++) {
+        _group[i].uid = uids[i];
+        _group[i].ok  = selectSlave(uids[i]);
+        success      &= _group[i].ok;
+    }
+
+    _group_size = count;
+
+    return success;
+} // BootloaderMaster::selectGroup
+
+std::size_t
+BootloaderMaster::groupSize() const
+{
+    return _group_size;
+}
+
+ModuleUID
+BootloaderMaster::groupSlaveID(
+    std::size_t i
+) const
+{
+    CORE_ASSERT(i < _group_size);
+    return _group[i].uid;
+}
+
+bool
+BootloaderMaster::groupSlaveOk(
+    std::size_t i
+) const
+{
+    CORE_ASSERT(i < _group_size);
+    return _group[i].ok;
+}
+
+bool
+BootloaderMaster::readBlockBitmap(
+    uint16_t              first,
+    payload::BlockBitmap& bitmap
+)
+{
+    if (commandUIDAndIndex(MessageType::BLOCK_STATUS, _selected, first)) {
+        AcknowledgeBlockBitmap* tmp = reinterpret_cast<AcknowledgeBlockBitmap*>(&_last_ack);
+        bitmap = tmp->data;
+        return bitmap.first == first;
+    }
+
+    return false;
+}
+
+void
+BootloaderMaster::makeBlock(
+    payload::Block& block,
+    uint16_t        index,
+    uint32_t        address,
+    const uint8_t*  image,
+    std::size_t     length
+)
+{
+    // Block i covers the i-th Block::SIZE aligned chunk of the image
+    uint32_t begin = (address - (address % payload::Block::SIZE)) + index * payload::Block::SIZE;
+    uint32_t end   = begin + payload::Block::SIZE;
+
+    begin = std::max(begin, address);
+    end   = std::min(end, static_cast<uint32_t>(address + length));
+
+    block.index   = index;
+    block.flags   = payload::Block::NO_ACK;
+    block.address = begin;
+    block.length  = end - begin;
+    memcpy(block.data, image + (begin - address), end - begin);
+}
+
+bool
+BootloaderMaster::writeGroupProgram(
+    uint32_t       address,
+    const uint8_t* image,
+    std::size_t    length
+)
+{
+    const uint32_t    first  = address - (address % payload::Block::SIZE);
+    const std::size_t blocks = (address + length - first + payload::Block::SIZE - 1) / payload::Block::SIZE;
+
+    if (blocks > 0xFFFF) {
+        return false;
+    }
+
+    payload::Block block;
+
+    for (std::size_t i = 0; i < _group_size; i++) {
+        if (_group[i].ok) {
+            _group[i].ok = selectSlave(_group[i].uid) && beginProgram();
+        }
+    }
+
+    // Everything once, to the whole group
+    for (std::size_t index = 0; index < blocks; index++) {
+        makeBlock(block, index, address, image, length);
+        sendBlock(block);
+        _statistics.bytes += block.length;
+
+        if ((index % BOOTLOADER_MASTER_WINDOW) == (BOOTLOADER_MASTER_WINDOW - 1)) {
+            core::os::Thread::sleep(core::os::Time::ms(BOOTLOADER_MASTER_MULTICAST_GAP_MS));
+        }
+    }
+
+    // Then, each slave reports what it has got, and what it is missing is published again
+    bool success = true;
+
+    for (std::size_t i = 0; i < _group_size; i++) {
+        GroupMember& member = _group[i];
+        std::size_t  rounds = 0;
+        std::size_t  chunk  = 0;
+
+        member.ok = member.ok && selectSlave(member.uid);
+
+        while (member.ok && (chunk < blocks)) {
+            payload::BlockBitmap bitmap;
+            std::size_t          missing = 0;
+
+            if (!readBlockBitmap(chunk, bitmap)) {
+                member.ok = false;
+                break;
+            }
+
+            for (std::size_t bit = 0; (bit < payload::BlockBitmap::BITS) && (chunk + bit < blocks); bit++) {
+                if ((bitmap.bits[bit / 8] & (1 << (bit % 8))) == 0) {
+                    makeBlock(block, chunk + bit, address, image, length);
+                    sendBlock(block);
+                    _statistics.resent++;
+
+                    if ((++missing % BOOTLOADER_MASTER_WINDOW) == 0) {
+                        core::os::Thread::sleep(core::os::Time::ms(BOOTLOADER_MASTER_MULTICAST_GAP_MS));
+                    }
+                }
+            }
+
+            if (missing == 0) {
+                chunk += payload::BlockBitmap::BITS;
+                rounds = 0;
+            } else if (++rounds > BOOTLOADER_MASTER_BLOCK_RETRIES) {
+                member.ok = false;
+            }
+        }
+
+        member.ok = member.ok && commandUIDAndCount(MessageType::BLOCK_END, _selected, blocks);
+        success  &= member.ok;
+    }
+
+    return success;
+} // BootloaderMaster::writeGroupProgram
+
+void
+BootloaderMaster::acknowledgeChunk(
+    const AcknowledgeMsg& ack
+)
+{
+    CORE_WARNINGS_NO_CAST_ALIGN
+    const AcknowledgeChunk* tmp = reinterpret_cast<const AcknowledgeChunk*>(&ack);
+    CORE_WARNINGS_RESET
+
+    core::os::SysLock::Scope lock;
+
+    if ((_bulk_buffer == nullptr) || (ack.sequenceId != static_cast<uint8_t>(_sequence_id + 1))) {
+        return; // Late, or for a previous request
+    }
+
+    if (ack.status != AcknowledgeStatus::OK) {
+        _bulk_status = ack.status;
+    } else {
+        uint32_t offset = tmp->data.offset;
+        uint32_t length = tmp->data.length;
+
+        if ((offset >= _bulk_offset) && (((offset - _bulk_offset) % payload::Chunk::SIZE) == 0) && (length <= payload::Chunk::SIZE)
+            && (offset + length <= _bulk_offset + _bulk_length)) {
+            memcpy(_bulk_buffer + (offset - _bulk_offset), tmp->data.data, length);
+            _bulk_received |= 1 << ((offset - _bulk_offset) / payload::Chunk::SIZE);
+        }
+    }
+
+    _window_event = true;
+
+    if (_window_runner != nullptr) {
+        core::os::Thread::wake(*(_window_runner), 0x1BADCAFE);
+        _window_runner = nullptr;
+    }
+} // BootloaderMaster::acknowledgeChunk
+
+void
+BootloaderMaster::disableBulkTags()
+{
+    // Same lock as the announce thread, which can insert into _slaves; the selected slave is never added here
+    core::os::SysLock::Scope lock;
+
+    SlaveDescription* slave = _slaves.find(_selected);
+
+    if (slave != nullptr) {
+        slave->_bulk_tags = false;
+    }
+}
+
+bool
+BootloaderMaster::readTagsBulk(
+    char*    buffer,
+    uint32_t size
+)
+{
+    const uint32_t       WINDOW_SIZE = BOOTLOADER_MASTER_WINDOW * payload::Chunk::SIZE;
+    const core::os::Time TIMEOUT     = core::os::Time::ms(BOOTLOADER_MASTER_BLOCK_TIMEOUT_MS);
+
+    bool success = true;
+
+    for (uint32_t offset = 0; success && (offset < size); offset += WINDOW_SIZE) {
+        uint32_t length   = std::min(WINDOW_SIZE, size - offset);
+        uint32_t chunks   = (length + payload::Chunk::SIZE - 1) / payload::Chunk::SIZE;
+        uint32_t expected = (chunks >= 32) ? 0xFFFFFFFF : ((1u << chunks) - 1);
+        bool     complete = false;
+
+        for (std::size_t retries = 0; !complete && (retries <= BOOTLOADER_MASTER_BLOCK_RETRIES); retries++) {
+            if (!beginCommand(MessageType::TAGS_READ_BULK)) {
+                break;
+            }
+
+            commandPayload<payload::UIDAndRange>()->uid    = _selected;
+            commandPayload<payload::UIDAndRange>()->offset = offset;
+            commandPayload<payload::UIDAndRange>()->length = length;
+
+            {
+                core::os::SysLock::Scope lock;
+
+                _bulk_buffer   = reinterpret_cast<uint8_t*>(buffer) + offset;
+                _bulk_offset   = offset;
+                _bulk_length   = length;
+                _bulk_received = 0;
+                _bulk_status   = AcknowledgeStatus::NONE;
+                _window_event  = false;
+            }
+
+            if (endCommand()) {
+                core::os::Time start = core::os::Time::now();
+                core::os::Time elapsed;
+
+                while ((elapsed = core::os::Time::now() - start) < TIMEOUT) {
+                    {
+                        core::os::SysLock::Scope lock;
+
+                        complete = (_bulk_received == expected);
+                    }
+
+                    if (complete || (_bulk_status != AcknowledgeStatus::NONE)) {
+                        break;
+                    }
+
+                    waitForBlockAck(TIMEOUT - elapsed);
+                }
+            }
+
+            {
+                core::os::SysLock::Scope lock;
+
+                _bulk_buffer = nullptr;
+                _ack_filter  = MessageType::NONE;
+                _sequence_id += 2; // As if the request had been acknowledged
+            }
+
+            if (_bulk_status != AcknowledgeStatus::NONE) {
+                if (_bulk_status == AcknowledgeStatus::NOT_IMPLEMENTED) {
+                    disableBulkTags();
+                }
+
+                break; // Refused: no point in trying again
+            }
+
+            if (_bulk_received == 0) {
+                // Not a single chunk: a legacy slave ignores the request, do not make every readTags() wait for it
+                disableBulkTags();
+                break;
+            }
+        }
+
+        success = complete;
+    }
+
+    return success;
+} // BootloaderMaster::readTagsBulk
+
 bool
 BootloaderMaster::readTags(char* buffer) {
 	if(_slaves[_selected]._version == SlaveDescription::Version::V3) {
 		uint32_t size = _slaves[_selected]._v3.tagsFlashSize;
+
+		if((size > 0) && _slaves[_selected]._bulk_tags) {
+			if(readTagsBulk(buffer, size)) {
+				return true;
+			}
+		}
+
 		if(size > 0) {
 			uint32_t offset = 0;
 			while(offset < size) {
@@ -6,6 +6,8 @@
 
 #include <core/mw/CoreConfiguration.hpp>
 
+#include <algorithm>
+
 NAMESPACE_CORE_MW_BEGIN
 
 const CoreConfigurationMap::FieldMetadata
@@ -13,11 +15,10 @@ CoreConfigurationMap::getField(
     CoreConfigurationMap::Key key
 ) const
 {
-    // Returning a copy of the field... Not a reference (that would be to a local)
-    for (FieldMetadata f : * this) {
-        if (key == f.key) {
-            return f;
-        }
+    std::size_t i = getFieldIndex(key);
+
+    if (i < getSize()) {
+        return getField(i);
     }
 
     CORE_ASSERT(!"field does not exist");
@@ -29,17 +30,7 @@ CoreConfigurationMap::getFieldIndex(
     CoreConfigurationMap::Key key
 ) const
 {
-    std::size_t i = 0;
-
-    for (FieldMetadata f : * this) {
-        if (key == f.key) {
-            return i;
-        }
-
-        i++;
-    }
-
-    return i; // this will be gt the last index. It will fire an assert in getField
+    return findField(hash(key.c_str()), key.c_str()); // if not found, this will be gt the last index. It will fire an assert in getField
 }
 
 //-------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
@@ -58,9 +49,7 @@ CoreConfigurationStatic_::set(
     const uint8_t* src = reinterpret_cast<const uint8_t*>(x);
     uint8_t*       dst = reinterpret_cast<uint8_t*>(obj + field.offset);
 
-    while (len--) {
-        *dst++ = *src++;
-    }
+    memcpy(dst, src, len);
 }
 
 void
@@ -78,22 +67,14 @@ CoreConfigurationStatic_::set(
 
     CORE_ASSERT(s1 >= s2 && t1 == t2);  // make sure we are doing something meaningful...
 
+    // Never write past the field, also when asserts are disabled
+    s2 = std::min(s2, s1);
+
     const char* src = reinterpret_cast<const char*>(x);
     char*       dst = reinterpret_cast<char*>(obj + field.offset);
 
-    std::size_t i = 0;
-
-    while (i < s2) {
-        // copy
-        *dst++ = *src++;
-        i++;
-    }
-
-    while (i < s1) {
-        // pad
-        *dst = 0;
-        i++;
-    }
+    memcpy(dst, src, s2); // copy
+    memset(dst + s2, 0, s1 - s2); // pad
 } // set
 
 //GET
@@ -112,9 +93,7 @@ CoreConfigurationStatic_::get(
     const uint8_t* src = reinterpret_cast<const uint8_t*>(obj + field.offset);
     uint8_t*       dst = reinterpret_cast<uint8_t*>(x);
 
-    while (len--) {
-        *dst++ = *src++;
-    }
+    memcpy(dst, src, len);
 }
 
 void
@@ -125,29 +104,17 @@ CoreConfigurationStatic_::get(
 )
 {
     std::size_t s1 = field.size;
-    std::size_t s2 = strlen(x);
 
     core::CoreType t1 = field.type;
     core::CoreType t2 = core::CoreType::CHAR;
 
-    CORE_ASSERT(s1 >= s2 && t1 == t2);    // make sure we are doing something meaningful...
+    CORE_ASSERT(t1 == t2);    // make sure we are doing something meaningful...
 
     const char* src = reinterpret_cast<const char*>(obj + field.offset);
     char*       dst = reinterpret_cast<char*>(x);
 
-    std::size_t i = 0;
-
-    while (i < s2) {
-        // copy
-        *dst++ = *src++;
-        i++;
-    }
-
-    while (i < s1) {
-        // pad
-        *dst = 0;
-        i++;
-    }
+    // The field is padded with \0 by set(): the copy is terminated, unless the string fills the whole field
+    memcpy(dst, src, s1); // copy
 } // get
 
 //-------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
@@ -260,10 +227,12 @@ CoreConfigurableBase::dumpConfigurationTo(
 ) const
 {
 	CORE_ASSERT(_key != nullptr);
-    CORE_ASSERT(size >= offset + NamingTraits<Node>::MAX_LENGTH + sizeof(CoreConfigurationBase::Signature) + getConfigurationSize());
+    CORE_ASSERT(size >= offset + NamingTraits<CoreConfigurableBase>::MAX_LENGTH + sizeof(CoreConfigurationBase::Signature) + getConfigurationSize());
 
-    memcpy(storage + offset, _key, NamingTraits<Node>::MAX_LENGTH);
-    offset += NamingTraits<Node>::MAX_LENGTH;
+    // The key is read back as NamingTraits<CoreConfigurableBase>::MAX_LENGTH chars, zero padded
+    memset(storage + offset, 0, NamingTraits<CoreConfigurableBase>::MAX_LENGTH);
+    strncpy(reinterpret_cast<char*>(storage + offset), _key, NamingTraits<CoreConfigurableBase>::MAX_LENGTH);
+    offset += NamingTraits<CoreConfigurableBase>::MAX_LENGTH;
 
     CoreConfigurationBase::Signature signature = getConfigurationSignature();
 
@@ -278,6 +247,8 @@ CoreConfigurableBase::dumpConfigurationTo(
     offset += dataSize;
 
     if ((dataSize % 4) != 0) {
+        // Zero the padding, so that the same configuration always gives the same image
+        memset(storage + offset, 0, 4 - (dataSize % 4));
         offset += 4 - (dataSize % 4);
     }
 
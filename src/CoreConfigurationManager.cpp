@@ -7,9 +7,12 @@
 #include <core/mw/namespace.hpp>
 #include <core/mw/CoreConfigurationManager.hpp>
 
+#include <cstddef>
+#include <cstring>
+
 NAMESPACE_CORE_MW_BEGIN
 
-CoreConfigurationManager::CoreConfigurationManager()
+CoreConfigurationManager::CoreConfigurationManager() : _index(), _indexed(0), _overflow(false)
 {}
 
 CoreConfigurationManager::~CoreConfigurationManager()
@@ -23,9 +26,94 @@ CoreConfigurationManager::add(
 	CORE_ASSERT(configurableObject.getKey() != nullptr);
 
     _objects.link(configurableObject.link);
+
+    // Keep the index at most half full, so that probe sequences stay short
+    if (_indexed >= CORE_CONFIGURATION_INDEX_LENGTH / 2) {
+        _overflow = true;
+        return;
+    }
+
+    CoreConfigurationMap::Hash hash = CoreConfigurationMap::hash(configurableObject.getKey(), NamingTraits<CoreConfigurableBase>::MAX_LENGTH);
+    std::size_t i = hash & (CORE_CONFIGURATION_INDEX_LENGTH - 1);
+
+    while (_index[i].object != nullptr) {
+        i = (i + 1) & (CORE_CONFIGURATION_INDEX_LENGTH - 1);
+    }
+
+    _index[i].hash   = hash;
+    _index[i].object = const_cast<CoreConfigurableBase*>(&configurableObject);
+    _indexed++;
+} // CoreConfigurationManager::add
+
+bool
+CoreConfigurationManager::setConfigurationFrom(
+    const uint8_t* storage,
+    std::size_t&   offset,
+    std::size_t    size
+)
+{
+    const char* key = reinterpret_cast<const char*>(storage + offset);
+
+    CoreConfigurationMap::Hash hash = CoreConfigurationMap::hash(key, NamingTraits<CoreConfigurableBase>::MAX_LENGTH);
+    std::size_t i = hash & (CORE_CONFIGURATION_INDEX_LENGTH - 1);
+
+    while (_index[i].object != nullptr) {
+        if ((_index[i].hash == hash) && _index[i].object->setConfigurationFrom(storage, offset, size, true)) {
+            return true;
+        }
+
+        i = (i + 1) & (CORE_CONFIGURATION_INDEX_LENGTH - 1);
+    }
+
+    if (_overflow) {
+        // Not all the objects are indexed...
+        for (CoreConfigurableBase& object : _objects) {
+            if (object.setConfigurationFrom(storage, offset, size, true)) {
+                return true;
+            }
+        }
+    }
+
+    return false;
+} // CoreConfigurationManager::setConfigurationFrom
+
+CoreConfigurableBase*
+CoreConfigurationManager::findObject(
+    const char* key
+)
+{
+    CoreConfigurationMap::Hash hash = CoreConfigurationMap::hash(key, NamingTraits<CoreConfigurableBase>::MAX_LENGTH);
+    std::size_t i = hash & (CORE_CONFIGURATION_INDEX_LENGTH - 1);
+
+    while (_index[i].object != nullptr) {
+        if ((_index[i].hash == hash) && (strncmp(_index[i].object->getKey(), key, NamingTraits<CoreConfigurableBase>::MAX_LENGTH) == 0)) {
+            return _index[i].object;
+        }
+
+        i = (i + 1) & (CORE_CONFIGURATION_INDEX_LENGTH - 1);
+    }
+
+    if (_overflow) {
+        // Not all the objects are indexed...
+        for (CoreConfigurableBase& object : _objects) {
+            if (strncmp(object.getKey(), key, NamingTraits<CoreConfigurableBase>::MAX_LENGTH) == 0) {
+                return &object;
+            }
+        }
+    }
+
+    return nullptr;
+} // CoreConfigurationManager::findObject
+
+static inline std::size_t
+padded(
+    std::size_t size
+)
+{
+    return (size + 3) & ~static_cast<std::size_t>(3);
 }
 
-void
+std::size_t
 CoreConfigurationManager::dumpTo(
     uint8_t*    storage,
     std::size_t size
@@ -43,6 +131,20 @@ CoreConfigurationManager::dumpTo(
     }
 
     memcpy(storage, &cnt, sizeof(std::size_t)); // Number of conf blocks
+
+    return sizeof(std::size_t) + offset;
+} // CoreConfigurationManager::dumpTo
+
+std::size_t
+CoreConfigurationManager::dumpSize() const
+{
+    std::size_t size = sizeof(std::size_t); // Number of conf blocks
+
+    for (const CoreConfigurableBase& object : _objects) {
+        size += NamingTraits<CoreConfigurableBase>::MAX_LENGTH + sizeof(CoreConfigurationBase::Signature) + padded(object.getConfigurationSize());
+    }
+
+    return size;
 }
 
 void
@@ -61,29 +163,99 @@ CoreConfigurationManager::setFrom(
         offset += sizeof(std::size_t);
 
         for (std::size_t i = 0; i < cnt; i++) {
-            // For every block...
-            for (CoreConfigurableBase& object : _objects) {
-                // Try with every object...
-                if (object.setConfigurationFrom(storage, offset, size - sizeof(std::size_t), true)) {
-                    // If the block matches the object...
-                    break; // Go on with the next block!
-                }
+            // For every block, find the object it belongs to...
+            if (!setConfigurationFrom(storage, offset, size - sizeof(std::size_t))) {
+                // ... the size of an unknown block is unknown, we cannot go on
+                break;
             }
         }
     }
 } // CoreConfigurationManager::setFrom
 
+bool
+CoreConfigurationManager::checkImage(
+    const uint8_t* image,
+    std::size_t    size,
+    std::size_t&   length,
+    bool           writable
+)
+{
+    std::size_t cnt;
+
+    memcpy(&cnt, image, sizeof(std::size_t)); // Number of conf blocks
+
+    if (cnt == 0xFFFFFFFF) {
+        // Erased
+        length = 0;
+        return true;
+    }
+
+    length = sizeof(std::size_t);
+
+    for (std::size_t i = 0; i < cnt; i++) {
+        if (length + NamingTraits<CoreConfigurableBase>::MAX_LENGTH + sizeof(CoreConfigurationBase::Signature) > size) {
+            return false;
+        }
+
+        CoreConfigurableBase* object = findObject(reinterpret_cast<const char*>(image + length));
+
+        if (object == nullptr) {
+            // The size of an unknown block is unknown
+            return false;
+        }
+
+        CoreConfigurationBase::Signature signature;
+        memcpy(&signature, image + length + NamingTraits<CoreConfigurableBase>::MAX_LENGTH, sizeof(CoreConfigurationBase::Signature));
+
+        if (signature != object->getConfigurationSignature()) {
+            // setFrom() would stop here
+            return false;
+        }
+
+        if (writable && object->isOverridingConfiguration()) {
+            return false;
+        }
+
+        length += NamingTraits<CoreConfigurableBase>::MAX_LENGTH + sizeof(CoreConfigurationBase::Signature) + padded(object->getConfigurationSize());
+
+        if (length > size) {
+            return false;
+        }
+    }
+
+    return true;
+} // CoreConfigurationManager::checkImage
+
+bool
+CoreConfigurationManager::canSetFrom(
+    const uint8_t* storage,
+    std::size_t    size
+)
+{
+    std::size_t length;
+
+    return checkImage(storage, size, length, true);
+}
+
 void
 CoreConfigurationManager::loadFrom(
     CoreConfigurationStorage& storage
 )
 {
     if ((storage.data() != nullptr) && (storage.size() != 0)) {
-        setFrom(reinterpret_cast<uint8_t*>(storage.data()), storage.size());
+        std::size_t bank;
+        uint32_t    sequence;
+
+        if (isLog(storage) && activeBank(storage, bank, sequence)) {
+            loadLog(storage, bank);
+        } else {
+            // Legacy format (or erased storage)
+            setFrom(reinterpret_cast<uint8_t*>(storage.data()), storage.size());
+        }
     }
 }
 
-void
+bool
 CoreConfigurationManager::saveTo(
     CoreConfigurationStorage& storage
 )
@@ -92,7 +264,9 @@ CoreConfigurationManager::saveTo(
 
     bool success = true;
 
-    if (storage.size() != 0) {
+    if (isLog(storage)) {
+        success &= saveLog(storage);
+    } else if (storage.size() != 0) {
         success &= storage.beginWrite();
 
         std::size_t offset = 0;
@@ -144,7 +318,312 @@ CoreConfigurationManager::saveTo(
 
     loadFrom(storage);
 
-    CORE_ASSERT(success);
-} // CoreConfigurationManager::dumpTo
+    return success;
+} // CoreConfigurationManager::saveTo
+
+// --- LOG-STRUCTURED STORAGE ------------------------------------------------
+
+
+bool
+CoreConfigurationManager::isLog(
+    CoreConfigurationStorage& storage
+)
+{
+    return (storage.eraseSize() != 0) && (bankSize(storage) != 0);
+}
+
+std::size_t
+CoreConfigurationManager::bankSize(
+    CoreConfigurationStorage& storage
+)
+{
+    std::size_t unit = storage.eraseSize();
+
+    return (unit != 0) ? ((storage.size() / unit) / 2) * unit : 0;
+}
+
+bool
+CoreConfigurationManager::activeBank(
+    CoreConfigurationStorage& storage,
+    std::size_t&              bank,
+    uint32_t&                 sequence
+)
+{
+    const uint8_t* base  = reinterpret_cast<const uint8_t*>(storage.data());
+    bool           found = false;
+
+    for (std::size_t i = 0; i < 2; i++) {
+        LogHeader header;
+        memcpy(&header, base + i * bankSize(storage), sizeof(LogHeader));
+
+        if (header.magic != LOG_MAGIC) {
+            continue;
+        }
+
+        // The newest bank wins (mind the wrap around)
+        if (!found || (static_cast<int32_t>(header.sequence - sequence) > 0)) {
+            bank     = i;
+            sequence = header.sequence;
+            found    = true;
+        }
+    }
+
+    return found;
+} // CoreConfigurationManager::activeBank
+
+bool
+CoreConfigurationManager::scanLog(
+    CoreConfigurationStorage& storage,
+    std::size_t               bank,
+    std::size_t&              end
+)
+{
+    const uint8_t* base   = reinterpret_cast<const uint8_t*>(storage.data());
+    std::size_t    offset = bank * bankSize(storage) + sizeof(LogHeader);
+    std::size_t    limit  = (bank + 1) * bankSize(storage);
+
+    while (offset + sizeof(LogRecord) <= limit) {
+        LogRecord record;
+        memcpy(&record, base + offset, sizeof(LogRecord));
+
+        if ((record.commit == ERASED) && (record.size == ERASED)) {
+            // Erased: this is the end of the log
+            end = offset;
+            return true;
+        }
+
+        if ((record.size == ERASED) || (offset + sizeof(LogRecord) + record.size > limit)) {
+            // Garbage: nothing can be appended after it
+            end = offset;
+            return false;
+        }
+
+        // Uncommitted records are skipped, but they still take their space
+        offset += sizeof(LogRecord) + record.size;
+    }
+
+    end = offset;
+    return true;
+} // CoreConfigurationManager::scanLog
+
+const uint8_t*
+CoreConfigurationManager::findRecord(
+    CoreConfigurationStorage&   storage,
+    std::size_t                 bank,
+    const CoreConfigurableBase& object
+)
+{
+    const uint8_t* base   = reinterpret_cast<const uint8_t*>(storage.data());
+    const uint8_t* found  = nullptr;
+    std::size_t    offset = bank * bankSize(storage) + sizeof(LogHeader);
+    std::size_t    end;
+
+    scanLog(storage, bank, end);
+
+    while (offset < end) {
+        LogRecord record;
+        memcpy(&record, base + offset, sizeof(LogRecord));
+
+        const uint8_t* key = base + offset + sizeof(LogRecord);
+
+        if ((record.commit == LOG_COMMIT) && (strncmp(object.getKey(), reinterpret_cast<const char*>(key), NamingTraits<CoreConfigurableBase>::MAX_LENGTH) == 0)) {
+            CoreConfigurationBase::Signature signature;
+            memcpy(&signature, key + NamingTraits<CoreConfigurableBase>::MAX_LENGTH, sizeof(CoreConfigurationBase::Signature));
+
+            if (signature == object.getConfigurationSignature()) {
+                // Keep going, the newest record wins
+                found = key + NamingTraits<CoreConfigurableBase>::MAX_LENGTH + sizeof(CoreConfigurationBase::Signature);
+            }
+        }
+
+        offset += sizeof(LogRecord) + record.size;
+    }
+
+    return found;
+} // CoreConfigurationManager::findRecord
+
+std::size_t
+CoreConfigurationManager::recordSize(
+    const CoreConfigurableBase& object
+)
+{
+    return sizeof(LogRecord) + NamingTraits<CoreConfigurableBase>::MAX_LENGTH + sizeof(CoreConfigurationBase::Signature) + padded(object.getConfigurationSize());
+}
+
+bool
+CoreConfigurationManager::appendRecord(
+    CoreConfigurationStorage&   storage,
+    std::size_t                 offset,
+    const CoreConfigurableBase& object
+)
+{
+    bool success = true;
+
+    std::size_t record = offset;
+
+    success &= storage.write32(record + offsetof(LogRecord, size), recordSize(object) - sizeof(LogRecord));
+    offset  += sizeof(LogRecord);
+
+    uint32_t tmp_buffer[NamingTraits<CoreConfigurableBase>::MAX_LENGTH / sizeof(uint32_t)];
+    memset(tmp_buffer, 0, sizeof(tmp_buffer));
+    strncpy(reinterpret_cast<char*>(tmp_buffer), object.getKey(), NamingTraits<CoreConfigurableBase>::MAX_LENGTH);
+
+    for (uint32_t word : tmp_buffer) {
+        success &= storage.write32(offset, word);
+        offset  += sizeof(uint32_t);
+    }
+
+    success &= storage.write32(offset, object.getConfigurationSignature());
+    offset  += sizeof(CoreConfigurationBase::Signature);
+
+    const uint8_t* data     = reinterpret_cast<const uint8_t*>(&object.getConfigurationBase());
+    std::size_t    dataSize = object.getConfigurationSize();
+
+    for (std::size_t i = 0; i < dataSize; i += sizeof(uint32_t)) {
+        uint32_t word = ERASED;
+        memcpy(&word, data + i, (dataSize - i < sizeof(uint32_t)) ? dataSize - i : sizeof(uint32_t));
+
+        success &= storage.write32(offset + i, word);
+    }
+
+    // The commit marker goes last: until it is written, the record does not exist
+    if (success) {
+        success &= storage.write32(record + offsetof(LogRecord, commit), LOG_COMMIT);
+    }
+
+    return success;
+} // CoreConfigurationManager::appendRecord
+
+void
+CoreConfigurationManager::loadLog(
+    CoreConfigurationStorage& storage,
+    std::size_t               bank
+)
+{
+    const uint8_t* base   = reinterpret_cast<const uint8_t*>(storage.data());
+    std::size_t    offset = bank * bankSize(storage) + sizeof(LogHeader);
+    std::size_t    end;
+
+    scanLog(storage, bank, end);
+
+    // Replay the log: newer records override older ones
+    while (offset < end) {
+        LogRecord record;
+        memcpy(&record, base + offset, sizeof(LogRecord));
+
+        if (record.commit == LOG_COMMIT) {
+            std::size_t tmpOffset = offset + sizeof(LogRecord);
+
+            setConfigurationFrom(base, tmpOffset, storage.size());
+        }
+
+        offset += sizeof(LogRecord) + record.size;
+    }
+} // CoreConfigurationManager::loadLog
+
+bool
+CoreConfigurationManager::saveLog(
+    CoreConfigurationStorage& storage
+)
+{
+    std::size_t bank;
+    uint32_t    sequence;
+
+    if (!activeBank(storage, bank, sequence)) {
+        // Erased, or legacy format. The legacy configuration is still in use while compacting to the second bank:
+        // if it does not fit in the first one, the migration would destroy it
+        std::size_t legacy;
+
+        if (!checkImage(reinterpret_cast<const uint8_t*>(storage.data()), storage.size(), legacy, false) || (legacy > bankSize(storage))) {
+            return false;
+        }
+
+        return compactLog(storage, 0, 0);
+    }
+
+    std::size_t end;
+
+    if (!scanLog(storage, bank, end)) {
+        return compactLog(storage, bank, sequence);
+    }
+
+    // Only the configurations that changed are appended
+    std::size_t needed = 0;
+
+    for (const CoreConfigurableBase& object : _objects) {
+        const uint8_t* current = findRecord(storage, bank, object);
+
+        if ((current == nullptr) || (memcmp(current, &object.getConfigurationBase(), object.getConfigurationSize()) != 0)) {
+            needed += recordSize(object);
+        }
+    }
+
+    if (needed == 0) {
+        return true;
+    }
+
+    if (end + needed > (bank + 1) * bankSize(storage)) {
+        return compactLog(storage, bank, sequence);
+    }
+
+    bool success = storage.beginProgram();
+
+    for (const CoreConfigurableBase& object : _objects) {
+        const uint8_t* current = findRecord(storage, bank, object);
+
+        if ((current == nullptr) || (memcmp(current, &object.getConfigurationBase(), object.getConfigurationSize()) != 0)) {
+            success &= appendRecord(storage, end, object);
+            end     += recordSize(object);
+        }
+    }
+
+    success &= storage.endProgram();
+
+    return success;
+} // CoreConfigurationManager::saveLog
+
+bool
+CoreConfigurationManager::compactLog(
+    CoreConfigurationStorage& storage,
+    std::size_t               from,
+    uint32_t                  sequence
+)
+{
+    std::size_t to     = 1 - from;
+    std::size_t start  = to * bankSize(storage);
+    std::size_t offset = start + sizeof(LogHeader);
+    bool        success = true;
+
+    for (const CoreConfigurableBase& object : _objects) {
+        offset += recordSize(object);
+    }
+
+    if (offset > start + bankSize(storage)) {
+        return false; // Sorry, the configurations do not fit in a bank...
+    }
+
+    success &= storage.beginProgram();
+
+    for (std::size_t address = start; address < start + bankSize(storage); address += storage.eraseSize()) {
+        success &= storage.erase(address);
+    }
+
+    offset = start + sizeof(LogHeader);
+
+    for (const CoreConfigurableBase& object : _objects) {
+        success &= appendRecord(storage, offset, object);
+        offset  += recordSize(object);
+    }
+
+    // The magic goes last: until it is written, the old bank is still the active one
+    if (success) {
+        success &= storage.write32(start + offsetof(LogHeader, sequence), sequence + 1);
+        success &= storage.write32(start + offsetof(LogHeader, magic), LOG_MAGIC);
+    }
+
+    success &= storage.endProgram();
+
+    return success;
+} // CoreConfigurationManager::compactLog
 
 NAMESPACE_CORE_MW_END
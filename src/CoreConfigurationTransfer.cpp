@@ -0,0 +1,471 @@
+/* COPYRIGHT (c) 2016-2018 Nova Labs SRL
+ *
+ * All rights reserved. All use of this software and documentation is
+ * subject to the License Agreement located in the file LICENSE.
+ */
+
+#include <core/mw/namespace.hpp>
+#include <core/mw/CoreConfigurationTransfer.hpp>
+#include <core/mw/Checksummer.hpp>
+
+#include <cstring>
+#include <new>
+
+NAMESPACE_CORE_MW_BEGIN
+
+static_assert(sizeof(CoreConfigurationTransfer::Request) < rpc::RPCMessage::PAYLOAD_SIZE, "sizeof(CoreConfigurationTransfer::Request) >= RPCMessage::PAYLOAD_SIZE");
+static_assert(sizeof(CoreConfigurationTransfer::Response) < rpc::RPCMessage::PAYLOAD_SIZE, "sizeof(CoreConfigurationTransfer::Response) >= RPCMessage::PAYLOAD_SIZE");
+
+uint32_t
+CoreConfigurationTransfer::crc(
+    const uint8_t* data,
+    std::size_t    length
+)
+{
+    return CRC32::compute(data, length);
+}
+
+// --- SERVER ----------------------------------------------------------------
+
+CoreConfigurationTransferServer::CoreConfigurationTransferServer(
+    const char*               rpc_name,
+    CoreConfigurationManager& manager,
+    CoreConfigurationStorage& storage,
+    uint8_t*                  buffer,
+    std::size_t               size
+) : _server(rpc_name), _manager(manager), _storage(storage), _rpc(nullptr), _buffer(buffer), _size(size), _length(0), _state(State::NONE), _transfer(0)
+{
+    _server.handler([this](const CoreConfigurationTransfer::Request& request, CoreConfigurationTransfer::Response& response) {
+            serve(request, response);
+        });
+
+    // COMMIT writes to the storage
+    _server.pooled(true);
+}
+
+bool
+CoreConfigurationTransferServer::start(
+    rpc::RPC& rpc
+)
+{
+    if (!rpc.addServer(_server)) {
+        return false;
+    }
+
+    _rpc = &rpc;
+
+    return true;
+}
+
+bool
+CoreConfigurationTransferServer::stop()
+{
+    if (_rpc == nullptr) {
+        return false;
+    }
+
+    bool success = _rpc->removeServer(_server);
+
+    _rpc = nullptr;
+
+    return success;
+}
+
+void
+CoreConfigurationTransferServer::serve(
+    const CoreConfigurationTransfer::Request& request,
+    CoreConfigurationTransfer::Response&      response
+)
+{
+    using Command = CoreConfigurationTransfer::Command;
+    using Status  = CoreConfigurationTransfer::Status;
+
+    response.status = Status::OK;
+    response.length = 0;
+    response.offset = request.offset;
+
+    if ((request.command != Command::BEGIN_READ) && (request.command != Command::BEGIN_WRITE) && (request.command != Command::BEGIN_DELTA)) {
+        if ((_state == State::NONE) || (request.transfer != _transfer)) {
+            // A stale request, from another (or an aborted) transfer
+            response.status   = Status::BAD_STATE;
+            response.transfer = _transfer;
+            return;
+        }
+    }
+
+    switch (request.command) {
+      case Command::BEGIN_READ:
+      case Command::BEGIN_DELTA:
+          _state = State::NONE;
+
+          if (_manager.dumpSize() > _size) {
+              response.status = Status::OUT_OF_RANGE;
+              break;
+          }
+
+          _length = _manager.dumpTo(_buffer, _size);
+          _transfer++;
+
+          if (request.command == Command::BEGIN_READ) {
+              _state = State::READING;
+              response.offset = _length;
+              response.crc    = CoreConfigurationTransfer::crc(_buffer, _length);
+          } else if ((request.offset == _length) && (request.crc == CoreConfigurationTransfer::crc(_buffer, _length))) {
+              // The client knows what we have, it will only send what changed
+              _state = State::WRITING;
+          } else {
+              response.status = Status::BASE_MISMATCH;
+          }
+
+          break;
+      case Command::BEGIN_WRITE:
+          _state = State::NONE;
+
+          if (request.offset > _size) {
+              response.status = Status::OUT_OF_RANGE;
+              break;
+          }
+
+          memset(_buffer, 0, request.offset);
+          _length = request.offset;
+          _transfer++;
+          _state = State::WRITING;
+          break;
+      case Command::READ:
+          if (_state != State::READING) {
+              response.status = Status::BAD_STATE;
+          } else if (request.offset >= _length) {
+              response.status = Status::OUT_OF_RANGE;
+          } else {
+              std::size_t length = _length - request.offset;
+
+              if (length > CoreConfigurationTransfer::CHUNK_SIZE) {
+                  length = CoreConfigurationTransfer::CHUNK_SIZE;
+              }
+
+              memcpy(response.data, _buffer + request.offset, length);
+              response.length = length;
+          }
+
+          break;
+      case Command::WRITE:
+          if (_state != State::WRITING) {
+              response.status = Status::BAD_STATE;
+          } else if ((request.length > CoreConfigurationTransfer::CHUNK_SIZE) || (request.offset + request.length > _length)) {
+              response.status = Status::OUT_OF_RANGE;
+          } else {
+              memcpy(_buffer + request.offset, request.data, request.length);
+              response.length = request.length;
+          }
+
+          break;
+      case Command::COMMIT:
+          if (_state != State::WRITING) {
+              response.status = Status::BAD_STATE;
+          } else if (request.offset != _length) {
+              response.status = Status::OUT_OF_RANGE;
+          } else if (request.crc != CoreConfigurationTransfer::crc(_buffer, _length)) {
+              response.status = Status::CRC_MISMATCH;
+          } else if (!_manager.canSetFrom(_buffer, _length)) {
+              // setFrom() would silently skip some blocks
+              response.status = Status::REJECTED;
+          } else {
+              // The configurations point into _buffer only until they are loaded back from the storage
+              _manager.setFrom(_buffer, _length);
+
+              if (!_manager.saveTo(_storage)) {
+                  response.status = Status::STORAGE_ERROR;
+              }
+
+              _state = State::NONE;
+          }
+
+          break;
+      case Command::ABORT:
+          _state = State::NONE;
+          break;
+      default:
+          response.status = Status::BAD_STATE;
+          break;
+    } // switch
+
+    response.transfer = _transfer;
+} // CoreConfigurationTransferServer::serve
+
+// --- CLIENT ----------------------------------------------------------------
+
+CoreConfigurationTransferClient::CoreConfigurationTransferClient(
+    const char*    rpc_name,
+    core::os::Time timeout
+) : _rpc(nullptr), _control(rpc_name, timeout), _service(), _slots(), _transfer(0), _timeout(timeout)
+{
+    for (std::size_t i = 0; i < CORE_CONFIGURATION_TRANSFER_WINDOW; i++) {
+        // Chunks are requested asynchronously, so that the window is kept full
+        new (&_clients[i]) Client(rpc_name, core::os::Time::IMMEDIATE);
+
+        client(i).callback([this, i](CoreConfigurationTransfer::Service&) {
+                _slots[i].done = true;
+            });
+    }
+}
+
+CoreConfigurationTransferClient::~CoreConfigurationTransferClient()
+{
+    close();
+
+    for (std::size_t i = 0; i < CORE_CONFIGURATION_TRANSFER_WINDOW; i++) {
+        client(i).~Client();
+    }
+}
+
+CoreConfigurationTransferClient::Client&
+CoreConfigurationTransferClient::client(
+    std::size_t i
+)
+{
+    return *reinterpret_cast<Client*>(&_clients[i]);
+}
+
+bool
+CoreConfigurationTransferClient::open(
+    rpc::RPC& rpc
+)
+{
+    if (_rpc != nullptr) {
+        return false;
+    }
+
+    _rpc = &rpc;
+
+    bool success = rpc.addClient(_control) && _control.open();
+
+    for (std::size_t i = 0; success && (i < CORE_CONFIGURATION_TRANSFER_WINDOW); i++) {
+        success = rpc.addClient(client(i)) && client(i).open();
+    }
+
+    if (!success) {
+        close();
+    }
+
+    return success;
+}
+
+bool
+CoreConfigurationTransferClient::close()
+{
+    if (_rpc == nullptr) {
+        return false;
+    }
+
+    _control.close();
+    _rpc->removeClient(_control);
+
+    for (std::size_t i = 0; i < CORE_CONFIGURATION_TRANSFER_WINDOW; i++) {
+        client(i).close();
+        _rpc->removeClient(client(i));
+        _slots[i].pending = false;
+    }
+
+    _rpc = nullptr;
+
+    return true;
+}
+
+bool
+CoreConfigurationTransferClient::read(
+    uint8_t*     image,
+    std::size_t  size,
+    std::size_t& length
+)
+{
+    if (!control(CoreConfigurationTransfer::Command::BEGIN_READ, 0, 0)) {
+        return false;
+    }
+
+    length = _service.response.offset;
+
+    uint32_t crc     = _service.response.crc;
+    bool     success = (length <= size);
+
+    success = success && stream(CoreConfigurationTransfer::Command::READ, nullptr, nullptr, image, length);
+    success = success && (CoreConfigurationTransfer::crc(image, length) == crc);
+
+    // Done
+    control(CoreConfigurationTransfer::Command::ABORT, 0, 0);
+
+    return success;
+}
+
+bool
+CoreConfigurationTransferClient::write(
+    const uint8_t* image,
+    std::size_t    length
+)
+{
+    return write(image, nullptr, length);
+}
+
+bool
+CoreConfigurationTransferClient::write(
+    const uint8_t* image,
+    const uint8_t* base,
+    std::size_t    length
+)
+{
+    if ((base == nullptr) || !control(CoreConfigurationTransfer::Command::BEGIN_DELTA, length, CoreConfigurationTransfer::crc(base, length))) {
+        // Either a full write was asked for, or the remote image is not the expected one
+        base = nullptr;
+
+        if (!control(CoreConfigurationTransfer::Command::BEGIN_WRITE, length, 0)) {
+            return false;
+        }
+    }
+
+    bool success = stream(CoreConfigurationTransfer::Command::WRITE, image, base, nullptr, length);
+
+    success = success && control(CoreConfigurationTransfer::Command::COMMIT, length, CoreConfigurationTransfer::crc(image, length));
+
+    if (!success) {
+        control(CoreConfigurationTransfer::Command::ABORT, 0, 0);
+    }
+
+    return success;
+} // CoreConfigurationTransferClient::write
+
+bool
+CoreConfigurationTransferClient::control(
+    CoreConfigurationTransfer::Command command,
+    uint32_t                           offset,
+    uint32_t                           crc
+)
+{
+    if (_rpc == nullptr) {
+        return false;
+    }
+
+    CoreConfigurationTransfer::Request& request = _service.request;
+
+    request.command  = command;
+    request.length   = 0;
+    request.transfer = _transfer;
+    request.offset   = offset;
+    request.crc      = crc;
+
+    _service.response.status = CoreConfigurationTransfer::Status::NONE;
+
+    if (!_control.call(_service)) {
+        return false;
+    }
+
+    if ((command == CoreConfigurationTransfer::Command::BEGIN_READ) || (command == CoreConfigurationTransfer::Command::BEGIN_WRITE) || (command == CoreConfigurationTransfer::Command::BEGIN_DELTA)) {
+        _transfer = _service.response.transfer;
+    }
+
+    return _service.response.status == CoreConfigurationTransfer::Status::OK;
+} // CoreConfigurationTransferClient::control
+
+bool
+CoreConfigurationTransferClient::stream(
+    CoreConfigurationTransfer::Command command,
+    const uint8_t*                     source,
+    const uint8_t*                     base,
+    uint8_t*                           destination,
+    std::size_t                        length
+)
+{
+    std::size_t offset  = 0;
+    bool        success = (_rpc != nullptr);
+    bool        pending;
+
+    do {
+        pending = false;
+
+        for (std::size_t i = 0; i < CORE_CONFIGURATION_TRANSFER_WINDOW; i++) {
+            Slot& slot = _slots[i];
+
+            if (slot.pending) {
+                if (slot.done && !client(i).busy()) {
+                    const CoreConfigurationTransfer::Response& response = slot.service.response;
+
+                    slot.pending = false;
+
+                    if ((response.status != CoreConfigurationTransfer::Status::OK) || (response.offset + response.length > length)) {
+                        success = false;
+                    } else if (destination != nullptr) {
+                        memcpy(destination + response.offset, response.data, response.length);
+                    }
+                } else if (core::os::Time::now() - slot.start > _timeout) {
+                    // The response has been lost: rebind the client, as it would wait for it forever...
+                    client(i).close();
+                    client(i).open();
+
+                    // ... and ask again for the same chunk
+                    if (success && (slot.retries < CORE_CONFIGURATION_TRANSFER_RETRIES)) {
+                        slot.retries++;
+                        slot.done  = false;
+                        slot.start = core::os::Time::now();
+
+                        if (!client(i).call(slot.service)) {
+                            slot.pending = false;
+                            success      = false;
+                        }
+                    } else {
+                        slot.pending = false;
+                        success      = false;
+                    }
+                }
+            }
+
+            if (!slot.pending && success) {
+                if (base != nullptr) {
+                    // Skip the chunks the remote module already has
+                    while (offset < length) {
+                        std::size_t n = ((length - offset) < CoreConfigurationTransfer::CHUNK_SIZE) ? (length - offset) : CoreConfigurationTransfer::CHUNK_SIZE;
+
+                        if (memcmp(source + offset, base + offset, n) != 0) {
+                            break;
+                        }
+
+                        offset += n;
+                    }
+                }
+
+                if (offset < length) {
+                    std::size_t n = ((length - offset) < CoreConfigurationTransfer::CHUNK_SIZE) ? (length - offset) : CoreConfigurationTransfer::CHUNK_SIZE;
+                    CoreConfigurationTransfer::Request& request = slot.service.request;
+
+                    request.command  = command;
+                    request.length   = n;
+                    request.transfer = _transfer;
+                    request.offset   = offset;
+
+                    if (source != nullptr) {
+                        memcpy(request.data, source + offset, n);
+                    }
+
+                    slot.done    = false;
+                    slot.pending = true;
+                    slot.retries = 0;
+                    slot.start   = core::os::Time::now();
+
+                    if (client(i).call(slot.service)) {
+                        offset += n;
+                    } else {
+                        slot.pending = false;
+                        success      = false;
+                    }
+                }
+            }
+
+            pending |= slot.pending;
+        }
+
+        if (pending) {
+            core::os::Thread::sleep(core::os::Time::ms(1));
+        }
+    } while (pending || (success && (offset < length)));
+
+    return success;
+} // CoreConfigurationTransferClient::stream
+
+NAMESPACE_CORE_MW_END
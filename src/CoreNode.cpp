@@ -5,6 +5,7 @@
  */
 
 #include <core/mw/CoreNode.hpp>
+#include <core/mw/StackProfiler.hpp>
 
 NAMESPACE_CORE_MW_BEGIN
 
@@ -19,6 +20,13 @@ CoreNode::CoreNode(
     _mustRun(false),
     _mustLoop(false),
     _mustTeardown(false),
+    _loopPeriod(core::os::Time::IMMEDIATE),
+    _loopStats(),
+    _barrier(nullptr),
+    _barrierTarget(State::NONE),
+    _dependencies(),
+    _numDependencies(0),
+    _dispatched(false),
     link(*this)
 {}
 
@@ -34,6 +42,13 @@ CoreNode::CoreNode(
     _mustRun(false),
     _mustLoop(false),
     _mustTeardown(false),
+    _loopPeriod(core::os::Time::IMMEDIATE),
+    _loopStats(),
+    _barrier(nullptr),
+    _barrierTarget(State::NONE),
+    _dependencies(),
+    _numDependencies(0),
+    _dispatched(false),
     link(*this)
 {}
 
@@ -45,9 +60,25 @@ CoreNode::CoreNode() :
     _mustRun(false),
     _mustLoop(false),
     _mustTeardown(false),
+    _loopPeriod(core::os::Time::IMMEDIATE),
+    _loopStats(),
+    _barrier(nullptr),
+    _barrierTarget(State::NONE),
+    _dependencies(),
+    _numDependencies(0),
+    _dispatched(false),
     link(*this)
 {}
 
+CoreNode::~CoreNode()
+{
+    if ((_runner != nullptr) && !_mustRun) {
+        // Torn down by its own thread
+        core::os::Thread::join(*_runner);
+        StackProfiler::release(_runner);
+    }
+}
+
 const char*
 CoreNode::name()
 {
@@ -60,8 +91,14 @@ CoreNode::setup()
     _mutex.acquire();
 
     if (_state() == State::NONE) {
+        if (_runner != nullptr) {
+            // The previous thread tore the node down by itself
+            core::os::Thread::join(*_runner);
+            StackProfiler::release(_runner);
+        }
+
         _mustRun = true;
-        _runner  = core::os::Thread::create_heap(nullptr, _workingAreaSize, core::os::Thread::PriorityEnum::NORMAL,
+        _runner  = StackProfiler::create_heap(_workingAreaSize, core::os::Thread::PriorityEnum::NORMAL,
                                                  [](void* arg) {
             reinterpret_cast<CoreNode*>(arg)->_run(); // execute the thread code in the thread
         }, this, _node.get_name());
@@ -93,17 +130,28 @@ CoreNode::teardown()
 
     _state(State::TEARING_DOWN);
 
-    core::os::Thread::join(*_runner);
+    core::os::Thread* runner = _runner;
+
+    if ((runner == nullptr) || (runner == &core::os::Thread::self())) {
+        // A thread can neither join, nor free, itself: the joining side will
+        return true;
+    }
+
+    core::os::Thread::join(*runner);
+    StackProfiler::release(runner);
+
+    _runner = nullptr;
 
     return true;
-}
+} // CoreNode::teardown
 
 bool
 CoreNode::execute(
     Action what
 )
 {
-    if (_runner == nullptr) {
+    if ((_runner == nullptr) || !_mustRun) {
+        // Not running, or torn down
         return false;
     }
 
@@ -185,6 +233,46 @@ CoreNode::state() const
     return _state();
 }
 
+bool
+CoreNode::dependsOn(
+    const CoreNode& node
+)
+{
+    if (_numDependencies >= CORE_NODE_MAX_DEPENDENCIES) {
+        return false;
+    }
+
+    _dependencies[_numDependencies++] = &node;
+
+    return true;
+}
+
+void
+CoreNode::arm(
+    CoreNodeBarrier& barrier,
+    State            target
+)
+{
+    core::os::SysLock::Scope lock;
+
+    if ((_currentState == target) || (_currentState == State::ERROR) || (_currentState == State::TEARING_DOWN)) {
+        // Already there...
+        barrier.arrive_unsafe(_currentState != target);
+        _barrier = nullptr;
+    } else {
+        _barrier       = &barrier;
+        _barrierTarget = target;
+    }
+}
+
+void
+CoreNode::disarm()
+{
+    core::os::SysLock::Scope lock;
+
+    _barrier = nullptr;
+}
+
 ICoreNode::State
 CoreNode::_state() const
 {
@@ -206,6 +294,16 @@ CoreNode::_state(
         }
     }
 
+    {
+        core::os::SysLock::Scope lock;
+
+        if ((_barrier != nullptr) && ((_currentState == _barrierTarget) || (_currentState == State::ERROR) || (_currentState == State::TEARING_DOWN))) {
+            // Let the manager know we are done
+            _barrier->arrive_unsafe(_currentState != _barrierTarget);
+            _barrier = nullptr;
+        }
+    }
+
     _condition.signal();
 }
 
@@ -255,8 +353,8 @@ CoreNode::_run()
         _mutex.release();
     }
 
+    // _runner is left to the joining side, that hands its working area back
     _currentState = State::NONE;
-    _runner       = nullptr;
 } // CoreNode::_run
 
 inline bool
@@ -372,14 +470,64 @@ CoreNode::_doLoop()
 {
     core::os::Thread::set_priority(_priority);
 
+    core::os::Time deadline;
+    bool           timed = false; // deadline is meaningful
+
     while (_mustLoop) {
         if (core::os::Thread::should_terminate()) {
             teardown();
+        } else if (_loopPeriod == core::os::Time::IMMEDIATE) {
+            // Free running: no timing
+            if (!onLoop()) {
+                _doError();
+                _mustLoop = false;
+            }
+
+            _loopStats.iterations++;
+            timed = false;
         } else {
+            core::os::Time begin = core::os::Time::now();
+
+            if (!timed) {
+                // First iteration with a period
+                deadline = begin;
+                timed    = true;
+            }
+
             if (!onLoop()) {
                 _doError();
                 _mustLoop = false;
             }
+
+            core::os::Time end       = core::os::Time::now();
+            uint32_t       execution = (end - begin).to_us_raw();
+            int32_t        late      = static_cast<int32_t>((begin - deadline).to_us_raw());
+
+            _loopStats.iterations++;
+            _loopStats.execution_last = execution;
+
+            if (execution > _loopStats.execution_max) {
+                _loopStats.execution_max = execution;
+            }
+
+            if ((late > 0) && (static_cast<uint32_t>(late) > _loopStats.jitter_max)) {
+                _loopStats.jitter_max = late;
+            }
+
+            deadline += _loopPeriod;
+
+            if (static_cast<int32_t>((end - deadline).to_us_raw()) >= 0) {
+                // Overrun: skip the missed deadlines, instead of running back to back to catch up
+                _loopStats.overruns++;
+
+                do {
+                    deadline += _loopPeriod;
+                } while (static_cast<int32_t>((end - deadline).to_us_raw()) >= 0);
+            }
+
+            if (_mustLoop) {
+                core::os::Thread::sleep_until(deadline);
+            }
         }
     }
 
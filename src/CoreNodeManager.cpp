@@ -8,7 +8,7 @@
 
 NAMESPACE_CORE_MW_BEGIN
 
-CoreNodeManager::CoreNodeManager()
+CoreNodeManager::CoreNodeManager() : _timeout(core::os::Time::INFINITE)
 {}
 
 CoreNodeManager::~CoreNodeManager()
@@ -22,34 +22,116 @@ CoreNodeManager::add(
     _nodes.link(node.link);
 }
 
+void
+CoreNodeManager::setTimeout(
+    core::os::Time timeout
+)
+{
+    _timeout = timeout;
+}
+
+bool
+CoreNodeManager::isReady(
+    const CoreNode&  node,
+    ICoreNode::State state,
+    bool             reverse
+)
+{
+    if (!reverse) {
+        // All the prerequisites are there
+        for (std::size_t i = 0; i < node._numDependencies; i++) {
+            if (node._dependencies[i]->state() != state) {
+                return false;
+            }
+        }
+    } else {
+        // All the dependents are there
+        for (const CoreNode& other : _nodes) {
+            for (std::size_t i = 0; i < other._numDependencies; i++) {
+                if ((other._dependencies[i] == &node) && (other.state() != state)) {
+                    return false;
+                }
+            }
+        }
+    }
+
+    return true;
+} // CoreNodeManager::isReady
+
 bool
 CoreNodeManager::syncronize(
     ICoreNode::Action action,
-    ICoreNode::State  state
+    ICoreNode::State  state,
+    bool              reverse
 )
 {
-    bool done  = true;
-    bool error = false;
+    core::os::Time start      = core::os::Time::now();
+    std::size_t    count      = 0;
+    std::size_t    dispatched = 0;
+    bool           success    = false;
+
+    _barrier.reset();
 
     for (CoreNode& node : _nodes) {
-        node.execute(action);
+        node._dispatched = false;
+        count++;
     }
 
-    do {
-        done  = true;
-        error = false;
+    while (true) {
+        std::size_t arrived = _barrier.arrived();
+        bool        stuck   = false;
+
+        for (CoreNode& node : _nodes) {
+            if (!node._dispatched && isReady(node, state, reverse)) {
+                node._dispatched = true;
+                dispatched++;
+
+                node.arm(_barrier, state);
 
-        core::os::Thread::yield();
+                if (!node.execute(action) && (node.state() != state)) {
+                    // The action is not admissible, and the node is not already there: it will never make it
+                    stuck = true;
+                }
+            }
+        }
+
+        if (stuck || _barrier.failed()) {
+            break;
+        }
+
+        if ((dispatched < count) && (dispatched == arrived)) {
+            // Everybody is waiting for somebody else: a circular dependency
+            break;
+        }
+
+        core::os::Time timeout = core::os::Time::INFINITE;
+
+        if (_timeout != core::os::Time::INFINITE) {
+            core::os::Time elapsed = core::os::Time::now() - start;
+
+            if (elapsed >= _timeout) {
+                break;
+            }
 
-        for (const CoreNode& node : _nodes) {
-            ICoreNode::State state2 = node.state();
+            timeout = _timeout - elapsed;
+        }
+
+        if (dispatched == count) {
+            success = _barrier.wait(count, timeout);
+            break;
+        }
 
-            done  &= state == state2;
-            error |= (state2 == ICoreNode::State::ERROR);
+        // Wait for someone to get there, it may unlock its dependents
+        if (!_barrier.wait(arrived + 1, timeout)) {
+            break;
         }
-    } while (!done && !error);
+    }
 
-    return done && !error;
+    for (CoreNode& node : _nodes) {
+        node.disarm();
+    }
+
+    return success;
 } // CoreNodeManager::syncronize
 
 bool
@@ -83,8 +165,8 @@ CoreNodeManager::stop()
 {
     bool success = true;
 
-    success &= syncronize(ICoreNode::Action::STOP, ICoreNode::State::IDLE);
-    success &= syncronize(ICoreNode::Action::FINALIZE, ICoreNode::State::SET_UP);
+    success &= syncronize(ICoreNode::Action::STOP, ICoreNode::State::IDLE, true);
+    success &= syncronize(ICoreNode::Action::FINALIZE, ICoreNode::State::SET_UP, true);
 
     return success;
 }
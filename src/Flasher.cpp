@@ -0,0 +1,329 @@
+/* COPYRIGHT (c) 2016-2018 Nova Labs SRL
+ *
+ * All rights reserved. All use of this software and documentation is
+ * subject to the License Agreement located in the file LICENSE.
+ */
+
+#include <core/mw/namespace.hpp>
+#include <core/mw/Flasher.hpp>
+#include <core/mw/StackProfiler.hpp>
+#include <core/os/OS.hpp>
+
+#include <algorithm>
+
+NAMESPACE_CORE_MW_BEGIN
+
+void
+Flasher::set_page_buffer(
+    Data page_buf[]
+)
+{
+    _buffers[0] = page_buf;
+    impl.set_page_buffer(page_buf);
+}
+
+void
+Flasher::begin()
+{
+    if (!is_double_buffered()) {
+        impl.begin();
+        return;
+    }
+
+    // A session left open: let the worker complete what has been committed, and discard the rest
+    stop();
+
+    _filling   = -1;
+    _stages[0] = Stage::FREE;
+    _stages[1] = Stage::FREE;
+    _error     = false;
+    _run       = true;
+
+    // Below the caller: the worker gets the CPU whenever the caller is waiting for more data
+    _worker = StackProfiler::create_heap(CORE_FLASHER_WORKER_STACK, core::os::Thread::PriorityEnum::NORMAL - 1, [](void* arg) {
+        reinterpret_cast<Flasher*>(arg)->worker();
+    }, this, "flasher");
+} // Flasher::begin
+
+bool
+Flasher::end()
+{
+    if (!is_double_buffered()) {
+        return impl.end();
+    }
+
+    bool success = drain();
+
+    stop();
+
+    return success;
+}
+
+bool
+Flasher::flash_aligned(
+    const Data* address,
+    const Data* bufp,
+    size_t      buflen
+)
+{
+    if (!is_double_buffered()) {
+        return impl.flash_aligned(address, bufp, buflen);
+    }
+
+    return exclusive([&]() {
+        return impl.flash_aligned(address, bufp, buflen);
+    });
+}
+
+bool
+Flasher::erase_aligned(
+    const Data* address,
+    size_t      length
+)
+{
+    if (!is_double_buffered()) {
+        return impl.erase_aligned(address, length);
+    }
+
+    return exclusive([&]() {
+        return impl.erase_aligned(address, length);
+    });
+}
+
+bool
+Flasher::erase(
+    const uint8_t* address,
+    size_t         length
+)
+{
+    if (!is_double_buffered()) {
+        return impl.erase(address, length);
+    }
+
+    return exclusive([&]() {
+        return impl.erase(address, length);
+    });
+}
+
+template <typename F>
+bool
+Flasher::exclusive(
+    F operation
+)
+{
+    // The staging buffers are free once drained: the port implementation can use the first one,
+    // and it flushes whatever it has staged before the pipeline gets the buffer back
+    bool success = drain();
+
+    impl.begin();
+    success = operation() && success;
+    success = impl.end() && success;
+
+    return success;
+}
+
+bool
+Flasher::stage(
+    const uint8_t* address,
+    const uint8_t* bufp,
+    size_t         buflen
+)
+{
+    while (buflen > 0) {
+        if (!is_within_bounds(address)) {
+            return false;
+        }
+
+        PageID page = page_of(address);
+
+        if ((_filling < 0) || (_pages[_filling] != page)) {
+            commit();
+
+            if (!acquire(page)) {
+                return false;
+            }
+        }
+
+        std::size_t offset = address - address_of(page);
+        std::size_t length = std::min(buflen, static_cast<std::size_t>(PAGE_SIZE) - offset);
+
+        memcpy(reinterpret_cast<uint8_t*>(_buffers[_filling]) + offset, bufp, length);
+
+        address += length;
+        bufp    += length;
+        buflen  -= length;
+    }
+
+    return !_error;
+} // Flasher::stage
+
+void
+Flasher::commit()
+{
+    if (_filling < 0) {
+        return;
+    }
+
+    int i = _filling;
+
+    _filling = -1;
+
+    if (_worker == nullptr) {
+        // No worker: program in the caller
+        if (!write_if_needed(_pages[i], _buffers[i])) {
+            _error = true;
+        }
+
+        _stages[i] = Stage::FREE;
+        return;
+    }
+
+    core::os::SysLock::Scope lock;
+
+    _stages[i] = Stage::COMMITTED;
+
+    if (_worker_waiting != nullptr) {
+        core::os::Thread::wake(*_worker_waiting, core::os::Thread::OK);
+        _worker_waiting = nullptr;
+    }
+} // Flasher::commit
+
+bool
+Flasher::acquire(
+    PageID page
+)
+{
+    int i = -1;
+
+    {
+        core::os::SysLock::Scope lock;
+
+        for (;;) {
+            bool busy = false;
+
+            i = -1;
+
+            for (int j = 0; j < 2; j++) {
+                if (_stages[j] == Stage::FREE) {
+                    i = j;
+                } else if ((_stages[j] == Stage::COMMITTED) && (_pages[j] == page)) {
+                    // The page must be programmed before its contents can be read back
+                    busy = true;
+                }
+            }
+
+            if ((i >= 0) && !busy) {
+                break;
+            }
+
+            _writer_waiting = &core::os::Thread::self();
+            core::os::Thread::sleep_timeout(core::os::Time::INFINITE);
+            _writer_waiting = nullptr;
+        }
+
+        _stages[i] = Stage::FILLING;
+    }
+
+    _pages[i] = page;
+
+    // Bytes not flashed keep their current contents
+    if (!read(page, _buffers[i])) {
+        _stages[i] = Stage::FREE;
+        return false;
+    }
+
+    _filling = i;
+
+    return true;
+} // Flasher::acquire
+
+bool
+Flasher::drain()
+{
+    commit();
+
+    core::os::SysLock::Scope lock;
+
+    while ((_stages[0] != Stage::FREE) || (_stages[1] != Stage::FREE)) {
+        _writer_waiting = &core::os::Thread::self();
+        core::os::Thread::sleep_timeout(core::os::Time::INFINITE);
+        _writer_waiting = nullptr;
+    }
+
+    return !_error;
+}
+
+void
+Flasher::stop()
+{
+    if (_worker == nullptr) {
+        return;
+    }
+
+    {
+        core::os::SysLock::Scope lock;
+
+        _run = false;
+
+        if (_worker_waiting != nullptr) {
+            core::os::Thread::wake(*_worker_waiting, core::os::Thread::OK);
+            _worker_waiting = nullptr;
+        }
+    }
+
+    core::os::Thread::join(*_worker);
+    StackProfiler::release(_worker);
+
+    _worker = nullptr;
+} // Flasher::stop
+
+void
+Flasher::worker()
+{
+    for (;;) {
+        int i = -1;
+
+        {
+            core::os::SysLock::Scope lock;
+
+            for (;;) {
+                for (int j = 0; j < 2; j++) {
+                    if (_stages[j] == Stage::COMMITTED) {
+                        i = j;
+                        break;
+                    }
+                }
+
+                // Committed pages are programmed even after stop()
+                if ((i >= 0) || !_run) {
+                    break;
+                }
+
+                _worker_waiting = &core::os::Thread::self();
+                core::os::Thread::sleep_timeout(core::os::Time::INFINITE);
+                _worker_waiting = nullptr;
+            }
+        }
+
+        if (i < 0) {
+            return;
+        }
+
+        bool success = write_if_needed(_pages[i], _buffers[i]);
+
+        core::os::SysLock::Scope lock;
+
+        if (!success) {
+            _error = true;
+        }
+
+        _stages[i] = Stage::FREE;
+
+        if (_writer_waiting != nullptr) {
+            core::os::Thread::wake(*_writer_waiting, core::os::Thread::OK);
+            _writer_waiting = nullptr;
+        }
+    }
+} // Flasher::worker
+
+NAMESPACE_CORE_MW_END
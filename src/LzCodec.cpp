@@ -0,0 +1,231 @@
+/* COPYRIGHT (c) 2016-2018 Nova Labs SRL
+ *
+ * All rights reserved. All use of this software and documentation is
+ * subject to the License Agreement located in the file LICENSE.
+ */
+
+#include <core/mw/namespace.hpp>
+#include <core/mw/LzCodec.hpp>
+
+#include <algorithm>
+#include <cstring>
+
+NAMESPACE_CORE_MW_BEGIN
+
+LzEncoder::LzEncoder()
+{
+    reset(nullptr, 0);
+}
+
+void
+LzEncoder::reset(
+    const uint8_t* data,
+    std::size_t    length
+)
+{
+    _data         = data;
+    _length       = length;
+    _position     = 0;
+    _group_length = 0;
+    _group_sent   = 0;
+
+    for (int32_t& head : _head) {
+        head = -1;
+    }
+}
+
+inline std::size_t
+LzEncoder::hash(
+    const uint8_t* p
+)
+{
+    // Fibonacci hashing: the multiply spreads all the 24 bits over the top HASH_BITS
+    const uint32_t key = (static_cast<uint32_t>(p[0]) << 16) | (static_cast<uint32_t>(p[1]) << 8) | p[2];
+
+    return static_cast<uint32_t>(key * 2654435761u) >> (32 - HASH_BITS);
+}
+
+std::size_t
+LzEncoder::encode(
+    uint8_t*    out,
+    std::size_t size
+)
+{
+    std::size_t n = 0;
+
+    while (n < size) {
+        if (_group_sent < _group_length) {
+            out[n++] = _group[_group_sent++];
+        } else if (_position < _length) {
+            group();
+        } else {
+            break;
+        }
+    }
+
+    return n;
+}
+
+void
+LzEncoder::group()
+{
+    uint8_t flags = 0;
+
+    _group_length = 1;
+    _group_sent   = 0;
+
+    for (std::size_t item = 0; (item < 8) && (_position < _length); item++) {
+        std::size_t offset;
+        std::size_t length = match(offset);
+
+        if (length >= LzCodec::MIN_MATCH) {
+            flags |= 1 << item;
+            _group[_group_length++] = static_cast<uint8_t>(offset - 1);
+            _group[_group_length++] = static_cast<uint8_t>(((offset - 1) >> 8) | ((length - LzCodec::MIN_MATCH) << 2));
+        } else {
+            length = 1;
+            _group[_group_length++] = _data[_position];
+        }
+
+        while (length-- > 0) {
+            insert(_position++);
+        }
+    }
+
+    _group[0] = flags;
+} // LzEncoder::group
+
+void
+LzEncoder::insert(
+    std::size_t position
+)
+{
+    if (position + LzCodec::MIN_MATCH <= _length) {
+        std::size_t h = hash(&_data[position]);
+
+        _prev[position % LzCodec::WINDOW] = _head[h];
+        _head[h] = static_cast<int32_t>(position);
+    }
+}
+
+std::size_t
+LzEncoder::match(
+    std::size_t& offset
+) const
+{
+    if (_position + LzCodec::MIN_MATCH > _length) {
+        return 0;
+    }
+
+    const std::size_t limit = std::min(static_cast<std::size_t>(LzCodec::MAX_MATCH), _length - _position);
+    std::size_t       best  = 0;
+    int32_t           candidate = _head[hash(&_data[_position])];
+
+    for (std::size_t chain = 0; (chain < MAX_CHAIN) && (candidate >= 0); chain++) {
+        std::size_t distance = _position - candidate;
+
+        if (distance > LzCodec::WINDOW) {
+            break;
+        }
+
+        std::size_t length = 0;
+
+        while ((length < limit) && (_data[candidate + length] == _data[_position + length])) {
+            length++;
+        }
+
+        if (length > best) {
+            best   = length;
+            offset = distance;
+
+            if (best == limit) {
+                break;
+            }
+        }
+
+        int32_t next = _prev[candidate % LzCodec::WINDOW];
+
+        // Entries are overwritten as the window slides: a chain only goes backwards
+        if (next >= candidate) {
+            break;
+        }
+
+        candidate = next;
+    }
+
+    return best;
+} // LzEncoder::match
+
+LzDecoder::LzDecoder()
+{
+    reset();
+}
+
+void
+LzDecoder::reset()
+{
+    memset(_window, 0, sizeof(_window));
+    _head        = 0;
+    _flags       = 0;
+    _items       = 0;
+    _token       = 0;
+    _have_token  = false;
+    _copy_offset = 0;
+    _copy_length = 0;
+}
+
+std::size_t
+LzDecoder::decode(
+    const uint8_t*& in,
+    std::size_t&    in_length,
+    uint8_t*        out,
+    std::size_t     out_size
+)
+{
+    std::size_t n = 0;
+
+    while (n < out_size) {
+        uint8_t byte;
+
+        if (_copy_length > 0) {
+            // A match can be longer than its offset: copy one byte at a time from the window
+            byte = _window[(_head + LzCodec::WINDOW - _copy_offset) % LzCodec::WINDOW];
+            _copy_length--;
+        } else if (in_length == 0) {
+            break;
+        } else if (_items == 0) {
+            _flags = *in++;
+            _items = 8;
+            in_length--;
+            continue;
+        } else if ((_flags & 1) == 0) {
+            byte = *in++;
+            in_length--;
+            _flags >>= 1;
+            _items--;
+        } else if (!_have_token) {
+            _token      = *in++;
+            _have_token = true;
+            in_length--;
+            continue;
+        } else {
+            uint8_t token = *in++;
+            in_length--;
+
+            _copy_offset = (_token | ((token & 0x03) << 8)) + 1;
+            _copy_length = (token >> 2) + LzCodec::MIN_MATCH;
+            _have_token  = false;
+            _flags     >>= 1;
+            _items--;
+            continue;
+        }
+
+        _window[_head] = byte;
+        _head          = (_head + 1) % LzCodec::WINDOW;
+        out[n++]       = byte;
+    }
+
+    return n;
+} // LzDecoder::decode
+
+NAMESPACE_CORE_MW_END
@@ -17,6 +17,7 @@
 #include <core/mw/Subscriber.hpp>
 #include <core/os/ScopedLock.hpp>
 #include <core/mw/CoreModule.hpp>
+#include <core/mw/StackProfiler.hpp>
 
 NAMESPACE_CORE_MW_BEGIN
 
@@ -53,7 +54,7 @@ Middleware::initialize(
 void
 Middleware::start()
 {
-    mgmt_threadp = core::os::Thread::create_static(mgmt_stackp, mgmt_stacklen, mgmt_priority, mgmt_threadf, nullptr, "CORE_MGMT");
+    mgmt_threadp = StackProfiler::create_static(mgmt_stackp, mgmt_stacklen, mgmt_priority, mgmt_threadf, nullptr, "CORE_MGMT");
     CORE_ASSERT(mgmt_threadp != nullptr);
 
     // Wait until the info topic is fully initialized
@@ -131,6 +132,35 @@ Middleware::reboot_remote(
     return false;
 }
 
+bool
+Middleware::publish_stack_usage()
+{
+    bool success = true;
+
+    for (std::size_t i = 0; i < StackProfiler::count(); i++) {
+        StackProfiler::Usage usage;
+        MgmtMsg* msgp;
+
+        if (!StackProfiler::usage(i, usage)) {
+            break;
+        }
+
+        if (mgmt_pub.alloc(msgp)) {
+            Message::reset_payload(*msgp);
+            msgp->type = MgmtMsg::STACK_USAGE;
+            strncpy(msgp->stack_usage.module, module_namep, NamingTraits<Middleware>::MAX_LENGTH);
+            strncpy(msgp->stack_usage.thread, usage.name, NamingTraits<Node>::MAX_LENGTH);
+            msgp->stack_usage.size = static_cast<uint16_t>(usage.size);
+            msgp->stack_usage.used = static_cast<uint16_t>(usage.used);
+            success &= mgmt_pub.publish_remotely(*msgp);
+        } else {
+            success = false;
+        }
+    }
+
+    return success;
+} // Middleware::publish_stack_usage
+
 void
 Middleware::add(
     Node& node
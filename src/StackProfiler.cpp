@@ -0,0 +1,226 @@
+/* COPYRIGHT (c) 2016-2018 Nova Labs SRL
+ *
+ * All rights reserved. All use of this software and documentation is
+ * subject to the License Agreement located in the file LICENSE.
+ */
+
+#include <core/mw/namespace.hpp>
+#include <core/mw/StackProfiler.hpp>
+#include <core/os/OS.hpp>
+
+#include <new>
+
+NAMESPACE_CORE_MW_BEGIN
+
+#if CORE_STACK_PROFILER
+StackProfiler::Entry StackProfiler::_entries[CORE_STACK_PROFILER_LENGTH];
+#endif
+
+core::os::Thread*
+StackProfiler::create_heap(
+    std::size_t                size,
+    core::os::Thread::Priority priority,
+    core::os::Thread::Function function,
+    void*                      arg,
+    const char*                name
+)
+{
+#if CORE_STACK_PROFILER
+    if (size != 0) {
+        // uint64_t, to keep the working area aligned as a stack must be
+        uint64_t* stack = new (std::nothrow) uint64_t[(size + sizeof(uint64_t) - 1) / sizeof(uint64_t)];
+
+        if (stack == nullptr) {
+            return nullptr;
+        }
+
+        paint(reinterpret_cast<uint32_t*>(stack), size);
+
+        core::os::Thread* thread = core::os::Thread::create_static(stack, size, priority, function, arg, name);
+
+        if (thread == nullptr) {
+            delete[] stack;
+            return nullptr;
+        }
+
+        // If the table is full the thread is not reported, and its working area is never freed
+        add(thread, name, reinterpret_cast<uint32_t*>(stack), size, true);
+
+        return thread;
+    }
+#endif // if CORE_STACK_PROFILER
+
+    return core::os::Thread::create_heap(nullptr, size, priority, function, arg, name);
+} // StackProfiler::create_heap
+
+core::os::Thread*
+StackProfiler::create_static(
+    void*                      stack,
+    std::size_t                size,
+    core::os::Thread::Priority priority,
+    core::os::Thread::Function function,
+    void*                      arg,
+    const char*                name
+)
+{
+#if CORE_STACK_PROFILER
+    paint(reinterpret_cast<uint32_t*>(stack), size);
+#endif
+
+    core::os::Thread* thread = core::os::Thread::create_static(stack, size, priority, function, arg, name);
+
+#if CORE_STACK_PROFILER
+    if (thread != nullptr) {
+        add(thread, name, reinterpret_cast<uint32_t*>(stack), size, false);
+    }
+#endif
+
+    return thread;
+}
+
+void
+StackProfiler::release(
+    core::os::Thread* thread
+)
+{
+#if CORE_STACK_PROFILER
+    uint32_t* stack = nullptr;
+
+    {
+        core::os::SysLock::Scope lock;
+
+        for (Entry& entry : _entries) {
+            if (entry.thread == thread) {
+                if (entry.owned) {
+                    stack = entry.stack;
+                }
+
+                entry.thread = nullptr;
+                break;
+            }
+        }
+    }
+
+    delete[] reinterpret_cast<uint64_t*>(stack);
+#else
+    (void)thread;
+#endif
+} // StackProfiler::release
+
+std::size_t
+StackProfiler::count()
+{
+    std::size_t count = 0;
+
+#if CORE_STACK_PROFILER
+    core::os::SysLock::Scope lock;
+
+    for (const Entry& entry : _entries) {
+        if (entry.thread != nullptr) {
+            count++;
+        }
+    }
+#endif
+
+    return count;
+}
+
+bool
+StackProfiler::usage(
+    std::size_t i,
+    Usage&      usage
+)
+{
+#if CORE_STACK_PROFILER
+    for (const Entry& entry : _entries) {
+        if (entry.thread != nullptr) {
+            if (i == 0) {
+                usage.name = entry.name;
+                usage.size = entry.size;
+                usage.used = entry.size - unused(entry.stack, entry.size);
+
+                return true;
+            }
+
+            i--;
+        }
+    }
+#else
+    (void)i;
+    (void)usage;
+#endif
+
+    return false;
+} // StackProfiler::usage
+
+bool
+StackProfiler::add(
+    core::os::Thread* thread,
+    const char*       name,
+    uint32_t*         stack,
+    std::size_t       size,
+    bool              owned
+)
+{
+#if CORE_STACK_PROFILER
+    core::os::SysLock::Scope lock;
+
+    for (Entry& entry : _entries) {
+        if (entry.thread == nullptr) {
+            entry.thread = thread;
+            entry.name   = name;
+            entry.stack  = stack;
+            entry.size   = size;
+            entry.owned  = owned;
+
+            return true;
+        }
+    }
+#else
+    (void)thread;
+    (void)name;
+    (void)stack;
+    (void)size;
+    (void)owned;
+#endif
+
+    return false;
+} // StackProfiler::add
+
+void
+StackProfiler::paint(
+    uint32_t*   stack,
+    std::size_t size
+)
+{
+    for (std::size_t i = 0; i < size / sizeof(uint32_t); i++) {
+        stack[i] = PATTERN;
+    }
+}
+
+std::size_t
+StackProfiler::unused(
+    const uint32_t* stack,
+    std::size_t     size
+)
+{
+    const uint32_t* p   = stack;
+    const uint32_t* end = stack + size / sizeof(uint32_t);
+
+    // The stack grows downwards, towards the thread descriptor at the base of the working area: skip the descriptor...
+    while ((p < end) && (*p != PATTERN)) {
+        p++;
+    }
+
+    // ... then, whatever is still painted has never been touched
+    std::size_t unused = 0;
+
+    while ((p < end) && (*p == PATTERN)) {
+        p++;
+        unused += sizeof(uint32_t);
+    }
+
+    return unused;
+} // StackProfiler::unused
+
+NAMESPACE_CORE_MW_END
@@ -0,0 +1,322 @@
+/* COPYRIGHT (c) 2016-2018 Nova Labs SRL
+ *
+ * All rights reserved. All use of this software and documentation is
+ * subject to the License Agreement located in the file LICENSE.
+ */
+
+/* Host benchmark: end to end flashing throughput of BootloaderMaster, for each transfer mode, against simulated slaves.
+ *
+ * Needs a host build of core-os and of this module, built with -DBOOTLOADER_MASTER_LOCAL_SLAVES=1,
+ * and the RAM flash instead of the port one: -I test/ram/include, and test/ram/src/impl/Flasher_.cpp.
+ * Together with test/SimulatedSlave.cpp.
+ */
+
+#include <core/mw/Middleware.hpp>
+#include <core/mw/BootloaderMaster.hpp>
+#include <core/mw/Flasher.hpp>
+#include <core/mw/LzCodec.hpp>
+
+#include "SimulatedSlave.hpp"
+
+#include <cstdio>
+#include <cstring>
+
+#if !BOOTLOADER_MASTER_LOCAL_SLAVES
+#error "The simulated slaves run on the same middleware as the master: build with BOOTLOADER_MASTER_LOCAL_SLAVES=1"
+#endif
+
+using core::os::Time;
+using core::mw::Flasher;
+using core::mw::Flasher_;
+using namespace core::mw::bootloader;
+
+static const std::size_t SLAVES      = 2;
+static const std::size_t SLAVE_PAGES = 64;
+static const std::size_t IMAGE_SIZE  = 32 * 1024;
+static const std::size_t RUNS        = 3;
+static const uint32_t    BASE        = Flasher::BASE_ADDRESS;
+
+struct Scenario {
+    const char*          name;
+    SimulatedSlave::Link link;
+    Time                 erase; //!< page erase time
+    Time                 program; //!< page program time
+};
+
+static const Scenario SCENARIOS[] = {
+    {"no delays", {Time::IMMEDIATE, 0}, Time::IMMEDIATE, Time::IMMEDIATE},
+    {"flash timing", {Time::IMMEDIATE, 0}, Time::ms(20), Time::ms(10)},
+    {"slow link, 1% loss", {Time::us(200), 10}, Time::ms(20), Time::ms(10)}
+};
+
+static uint8_t image[IMAGE_SIZE];
+static uint8_t changed[IMAGE_SIZE];
+
+static BootloaderMaster*       master;
+static SimulatedSlave*         slaves[SLAVES];
+static core::mw::LzEncoder     encoder;
+static uint8_t                 mgmt_stack[4096];
+
+/* Something between code and data: runs of random bytes, and repeated sequences, for the compressed transfer.
+ */
+static void
+make_image()
+{
+    uint32_t random = 1;
+
+    for (std::size_t i = 0; i < IMAGE_SIZE; i++) {
+        random = random * 1103515245u + 12345u;
+
+        if (((i / 512) % 3 == 0) || (i < 64)) {
+            image[i] = static_cast<uint8_t>(random >> 16);
+        } else if ((random >> 16) % 8 == 0) {
+            image[i] = static_cast<uint8_t>(random >> 24);
+        } else {
+            image[i] = image[i - 64 + ((random >> 20) % 8)];
+        }
+    }
+
+    memcpy(changed, image, IMAGE_SIZE);
+    changed[IMAGE_SIZE / 2] ^= 0x5A; // A single page differs
+}
+
+static void
+ihex_record(
+    char           string[44],
+    uint8_t        type,
+    uint16_t       offset,
+    const uint8_t* data,
+    std::size_t    length
+)
+{
+    uint8_t sum = static_cast<uint8_t>(length + (offset >> 8) + offset + type);
+    int     n   = snprintf(string, 44, ":%02X%04X%02X", static_cast<unsigned>(length), offset, type);
+
+    for (std::size_t i = 0; i < length; i++) {
+        n   += snprintf(string + n, 44 - n, "%02X", data[i]);
+        sum += data[i];
+    }
+
+    snprintf(string + n, 44 - n, "%02X", static_cast<uint8_t>(0x100 - sum));
+}
+
+static bool
+write_ihex(
+    SimulatedSlave& slave
+)
+{
+    char string[44];
+    bool success = master->selectSlave(slave.uid()) && master->eraseProgram() && master->beginIHex();
+
+    for (std::size_t offset = 0; success && (offset < IMAGE_SIZE); offset += 16) {
+        uint32_t address = BASE + offset;
+
+        if ((offset == 0) || ((address & 0xFFFF) == 0)) {
+            uint8_t base[2] = {
+                static_cast<uint8_t>(address >> 24), static_cast<uint8_t>(address >> 16)
+            };
+
+            memset(string, 0, sizeof(string));
+            ihex_record(string, 0x04, 0, base, sizeof(base));
+            success = master->writeIHex(string);
+        }
+
+        memset(string, 0, sizeof(string));
+        ihex_record(string, 0x00, address & 0xFFFF, &image[offset], 16);
+        success = success && master->writeIHex(string);
+    }
+
+    memset(string, 0, sizeof(string));
+    ihex_record(string, 0x01, 0, nullptr, 0);
+
+    success = success && master->writeIHex(string) && master->endIHex();
+
+    return master->deselectSlave() && success;
+} // write_ihex
+
+static bool
+write_blocks(
+    SimulatedSlave& slave
+)
+{
+    bool success = master->selectSlave(slave.uid()) && master->eraseProgram() && master->beginProgram()
+                   && master->writeProgram(BASE, image, IMAGE_SIZE) && master->endProgram();
+
+    return master->deselectSlave() && success;
+}
+
+static bool
+write_diff(
+    SimulatedSlave& slave
+)
+{
+    // From the image to the changed one, and back: a single page gets written each time
+    static bool   back = false;
+    const uint8_t* next = back ? image : changed;
+    std::size_t   pages = 0;
+
+    back = !back;
+
+    bool success = master->selectSlave(slave.uid()) && master->writeProgramDiff(BASE, next, IMAGE_SIZE, &pages) && (pages == 1);
+
+    return master->deselectSlave() && success;
+}
+
+static bool
+write_compressed(
+    SimulatedSlave& slave
+)
+{
+    std::size_t compressed = 0;
+    bool        success    = master->selectSlave(slave.uid()) && master->eraseProgram()
+                             && master->writeProgramCompressed(BASE, image, IMAGE_SIZE, encoder, &compressed);
+
+    return master->deselectSlave() && success;
+}
+
+static bool
+write_group(
+    SimulatedSlave&
+)
+{
+    ModuleUID uids[SLAVES];
+    bool      success = true;
+
+    for (std::size_t i = 0; i < SLAVES; i++) {
+        uids[i]  = slaves[i]->uid();
+        success &= master->selectSlave(uids[i]) && master->eraseProgram() && master->deselectSlave();
+    }
+
+    success = success && master->selectGroup(uids, SLAVES) && master->writeGroupProgram(BASE, image, IMAGE_SIZE);
+
+    for (std::size_t i = 0; i < SLAVES; i++) {
+        success &= master->selectSlave(uids[i]) && master->deselectSlave();
+    }
+
+    return success;
+}
+
+struct Mode {
+    const char* name;
+    bool        (* write)(SimulatedSlave& slave);
+    std::size_t slaves; //!< slaves programmed at once
+    bool        diff;
+};
+
+static const Mode MODES[] = {
+    {"ihex", write_ihex, 1, false},
+    {"blocks", write_blocks, 1, false},
+    {"blocks, diff", write_diff, 1, true},
+    {"compressed", write_compressed, 1, false},
+    {"multicast", write_group, SLAVES, false}
+};
+
+static bool
+check(
+    const Mode& mode
+)
+{
+    for (std::size_t i = 0; i < mode.slaves; i++) {
+        // After an even number of diff runs, the slave is back to the image
+        if (memcmp(slaves[i]->program(), image, IMAGE_SIZE) != 0) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static bool
+run(
+    const Scenario& scenario,
+    const Mode&     mode
+)
+{
+    const std::size_t runs = mode.diff ? 2 * RUNS : RUNS;
+
+    bool success = true;
+
+    // The diff transfer starts from a programmed slave
+    if (mode.diff) {
+        success &= write_blocks(*slaves[0]);
+    }
+
+    master->resetStatistics();
+
+    Flasher_::Statistics flash   = Flasher_::statistics();
+    Time                 start   = Time::now();
+
+    for (std::size_t i = 0; success && (i < runs); i++) {
+        success &= mode.write(*slaves[0]);
+    }
+
+    Time elapsed = Time::now() - start;
+
+    success &= check(mode);
+
+    const BootloaderMaster::Statistics& statistics = master->statistics();
+    Flasher_::Statistics                after      = Flasher_::statistics();
+    double                              seconds    = elapsed.to_us_raw() / 1e6;
+
+    printf("%-20s %-14s %-4s %8.3f images/s %10.0f B/s %7u commands %7u blocks %5u resent %4u timeouts %6u erased %6u written\n",
+           scenario.name, mode.name, success ? "OK" : "FAIL",
+           runs * mode.slaves / seconds, runs * mode.slaves * IMAGE_SIZE / seconds,
+           static_cast<unsigned>(statistics.commands), static_cast<unsigned>(statistics.blocks), static_cast<unsigned>(statistics.resent),
+           static_cast<unsigned>(statistics.timeouts), static_cast<unsigned>(after.erased - flash.erased), static_cast<unsigned>(after.written - flash.written));
+
+    return success;
+} // run
+
+int
+main()
+{
+    static_assert(IMAGE_SIZE <= SLAVE_PAGES * Flasher::PAGE_SIZE, "The image does not fit a slave");
+    static_assert(SLAVES * SLAVE_PAGES <= CORE_FLASHER_RAM_PAGES, "The slaves do not fit the flash");
+
+    core::os::OS::initialize();
+    core::mw::Middleware::instance().initialize("bench", mgmt_stack, sizeof(mgmt_stack), core::os::Thread::PriorityEnum::LOWEST);
+    core::mw::Middleware::instance().start();
+
+    make_image();
+
+    master = new BootloaderMaster();
+
+    for (std::size_t i = 0; i < SLAVES; i++) {
+        char name[16];
+
+        snprintf(name, sizeof(name), "sim%u", static_cast<unsigned>(i));
+        slaves[i] = new SimulatedSlave(0x10000000 + i, "SIMULATED", name, i * SLAVE_PAGES, SLAVE_PAGES);
+        slaves[i]->start();
+    }
+
+    master->start();
+
+    // Wait for the announces, then describe all the slaves (multicast needs to know their module type)
+    while (master->slavesCount() < SLAVES) {
+        core::os::Thread::sleep(Time::ms(100));
+    }
+
+    bool success = master->ls();
+
+    for (const Scenario& scenario : SCENARIOS) {
+        for (SimulatedSlave* slave : slaves) {
+            slave->setLink(scenario.link);
+        }
+
+        Flasher_::set_timing(scenario.erase, scenario.program);
+
+        for (const Mode& mode : MODES) {
+            success &= run(scenario, mode);
+        }
+    }
+
+    master->stop();
+
+    for (SimulatedSlave* slave : slaves) {
+        slave->stop();
+    }
+
+    printf("BootloaderMaster: %s\n", success ? "OK" : "FAIL");
+
+    return success ? 0 : 1;
+} // main
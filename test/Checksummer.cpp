@@ -0,0 +1,155 @@
+/* COPYRIGHT (c) 2016-2018 Nova Labs SRL
+ *
+ * All rights reserved. All use of this software and documentation is
+ * subject to the License Agreement located in the file LICENSE.
+ */
+
+/* Host test and benchmark: Checksummer and CRC32.
+ *
+ * g++ -std=c++11 -O2 -I include test/Checksummer.cpp src/Checksummer.cpp -o checksummer_test && ./checksummer_test
+ * Build it again with -DCORE_CRC32_SLICE_BY_8=0 to test the single table engine.
+ */
+
+#include <core/mw/Checksummer.hpp>
+
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+using core::mw::Checksummer;
+using core::mw::CRC32;
+
+// The references: one byte, or one bit, at a time
+static uint8_t
+sum(
+    const uint8_t* data,
+    std::size_t    length
+)
+{
+    uint8_t accumulator = 0;
+
+    while (length--) {
+        accumulator += *data++;
+    }
+
+    return accumulator;
+}
+
+static uint32_t
+crc(
+    const uint8_t* data,
+    std::size_t    length
+)
+{
+    uint32_t crc = 0xFFFFFFFF;
+
+    while (length--) {
+        crc ^= *data++;
+
+        for (std::size_t i = 0; i < 8; i++) {
+            crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+        }
+    }
+
+    return ~crc;
+}
+
+template <typename F>
+static double
+throughput(
+    std::size_t length,
+    F           f
+)
+{
+    const std::size_t ROUNDS = 32;
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (std::size_t i = 0; i < ROUNDS; i++) {
+        f();
+    }
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    return (ROUNDS * length) / elapsed.count() / 1e6;
+}
+
+int
+main()
+{
+    // CRC-32 (IEEE 802.3) known answers
+    assert(CRC32::compute("", 0) == 0x00000000);
+    assert(CRC32::compute("a", 1) == 0xE8B7BE43);
+    assert(CRC32::compute("123456789", 9) == 0xCBF43926);
+    assert(CRC32::compute("The quick brown fox jumps over the lazy dog", 43) == 0x414FA339);
+
+    // Checksummer known answers
+    assert(Checksummer("123456789", 9).get_accumulator() == 0xDD);
+    assert(Checksummer("123456789", 9).compute_checksum() == 0x23);
+    assert(Checksummer::accumulate<0x01020304>() == 0x0A);
+
+    std::vector<uint8_t> buffer(1 << 16);
+
+    srand(1);
+
+    for (uint8_t& byte : buffer) {
+        byte = static_cast<uint8_t>(rand());
+    }
+
+    // Every alignment and every tail length of the word and slice loops, then larger blocks split in two calls
+    for (std::size_t test = 0; test < 4000; test++) {
+        std::size_t    offset = test % 16;
+        std::size_t    length = (test < 2000) ? (test / 16) : static_cast<std::size_t>(rand()) % (buffer.size() - 16);
+        std::size_t    split  = (length > 0) ? static_cast<std::size_t>(rand()) % length : 0;
+        const uint8_t* data   = buffer.data() + offset;
+
+        Checksummer checksummer;
+        checksummer.add(static_cast<uint8_t>(0x5A));
+        checksummer.add(data, split);
+        checksummer.add(data + split, length - split);
+        assert(checksummer.get_accumulator() == static_cast<uint8_t>(sum(data, length) + 0x5A));
+
+        CRC32 crc32;
+        crc32.add(data, split);
+        crc32.add(data + split, length - split);
+        assert(crc32.get() == crc(data, length));
+    }
+
+    // fill() is the same as adding the bytes
+    std::vector<uint8_t> erased(1000, 0xFF);
+
+    for (std::size_t length = 0; length < erased.size(); length += 37) {
+        CRC32 crc32;
+        crc32.add(buffer.data(), 3);
+        crc32.fill(0xFF, length);
+
+        CRC32 reference(buffer.data(), 3);
+        reference.add(erased.data(), length);
+
+        assert(crc32.get() == reference.get());
+    }
+
+    printf("Checksummer: OK\n");
+
+    // Throughput, against the byte at a time references
+    volatile uint32_t sink;
+
+    printf("checksum, bytes: %8.1f MB/s\n", throughput(buffer.size(), [&] {
+        sink = sum(buffer.data(), buffer.size());
+    }));
+    printf("checksum, words: %8.1f MB/s\n", throughput(buffer.size(), [&] {
+        sink = Checksummer(buffer.data(), buffer.size()).get_accumulator();
+    }));
+    printf("CRC-32, bits:    %8.1f MB/s\n", throughput(buffer.size(), [&] {
+        sink = crc(buffer.data(), buffer.size());
+    }));
+    printf("CRC-32, table:   %8.1f MB/s (%s)\n", throughput(buffer.size(), [&] {
+        sink = CRC32::compute(buffer.data(), buffer.size());
+    }), CORE_CRC32_SLICE_BY_8 ? "slice-by-8" : "single table");
+
+    (void)sink;
+    return 0;
+} // main
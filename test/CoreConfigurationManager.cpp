@@ -0,0 +1,124 @@
+/* COPYRIGHT (c) 2016-2018 Nova Labs SRL
+ *
+ * All rights reserved. All use of this software and documentation is
+ * subject to the License Agreement located in the file LICENSE.
+ */
+
+/* Host test: key hash (FNV-1a) and the hashed index of CoreConfigurationManager.
+ *
+ * Needs the core-common and core-os headers, and a host build of core-os:
+ * g++ -std=c++11 -I include test/CoreConfigurationManager.cpp src/CoreConfiguration.cpp src/CoreConfigurationManager.cpp ...
+ */
+
+#include <core/mw/CoreConfiguration.hpp>
+#include <core/mw/CoreConfigurationManager.hpp>
+
+#include <cassert>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+
+using core::mw::CoreConfigurationMap;
+
+// FNV-1a known answers, at compile time...
+static_assert(CoreConfigurationMap::hash("") == 0x811c9dc5u, "FNV-1a offset basis");
+static_assert(CoreConfigurationMap::hash("a") == 0xe40c292cu, "FNV-1a(\"a\")");
+static_assert(CoreConfigurationMap::hash("foobar") == 0xbf9cf968u, "FNV-1a(\"foobar\")");
+
+// ... and at most n characters are hashed
+static_assert(CoreConfigurationMap::hash("foobar", 1) == CoreConfigurationMap::hash("f"), "FNV-1a length");
+static_assert(CoreConfigurationMap::hash("0123456789abcdefXYZ") == CoreConfigurationMap::hash("0123456789abcdef"), "FNV-1a key length");
+
+CORE_CONFIGURATION_BEGIN_FULL(TestConfiguration, 2, 0x5EED)
+CORE_CONFIGURATION_FIELD(gain, FLOAT32, 1)
+CORE_CONFIGURATION_FIELD(table, UINT32, 4)
+CORE_CONFIGURATION_END()
+
+CORE_CONFIGURATION_MAP_BEGIN(TestConfiguration)
+CORE_CONFIGURATION_MAP_ENTRY(TestConfiguration, gain, FLOAT32, 1)
+CORE_CONFIGURATION_MAP_ENTRY(TestConfiguration, table, UINT32, 4)
+CORE_CONFIGURATION_MAP_END()
+
+struct TestConfigurable:
+    public core::mw::CoreConfigurable<TestConfiguration>{
+    TestConfigurable(
+        const char* key
+    ) : core::mw::CoreConfigurable<TestConfiguration>(key) {}
+};
+
+// More objects than the index holds (CORE_CONFIGURATION_INDEX_LENGTH / 2): the others are looked up linearly
+static const std::size_t OBJECTS = CORE_CONFIGURATION_INDEX_LENGTH / 2 + 8;
+
+static char              keys[OBJECTS][16];
+static TestConfigurable* source[OBJECTS];
+static TestConfigurable* target[OBJECTS];
+static TestConfigurable* other[OBJECTS];
+static uint8_t           image[OBJECTS * 64 + 64];
+
+int
+main()
+{
+    // Runtime known answers
+    assert(CoreConfigurationMap::hash("") == 0x811c9dc5u);
+    assert(CoreConfigurationMap::hash("a") == 0xe40c292cu);
+    assert(CoreConfigurationMap::hash("foobar") == 0xbf9cf968u);
+
+    // Compile time keys hash as runtime ones
+    assert(CORE_CONFIGURATION_KEY("gain").hash == CoreConfigurationMap::hash(CoreConfigurationMap::Key("gain").c_str()));
+
+    static core::mw::CoreConfigurationManager from;
+    static core::mw::CoreConfigurationManager to;
+    static core::mw::CoreConfigurationManager partial;
+
+    for (std::size_t i = 0; i < OBJECTS; i++) {
+        snprintf(keys[i], sizeof(keys[i]), "node_%u", static_cast<unsigned>(i));
+
+        source[i] = new TestConfigurable(keys[i]);
+        source[i]->overrideConfiguration();
+        source[i]->overridingConfiguration().gain     = static_cast<float>(i);
+        source[i]->overridingConfiguration().table[3] = static_cast<uint32_t>(i * 1000);
+        from.add(*source[i]);
+
+        target[i] = new TestConfigurable(keys[i]);
+        other[i]  = new TestConfigurable(keys[i]);
+    }
+
+    // Registered in the opposite order, so that the image is not in index order
+    for (std::size_t i = OBJECTS; i-- > 0;) {
+        to.add(*target[i]);
+    }
+
+    // All indexed, no linear fallback
+    const std::size_t INDEXED = CORE_CONFIGURATION_INDEX_LENGTH / 2;
+
+    for (std::size_t i = INDEXED; i-- > 0;) {
+        partial.add(*other[i]);
+    }
+
+    assert(from.dumpSize() <= sizeof(image));
+    std::size_t length = from.dumpTo(image, sizeof(image));
+    assert(length <= from.dumpSize());
+
+    // An image with a block that no object claims cannot be applied as a whole
+    assert(to.canSetFrom(image, length));
+    assert(!partial.canSetFrom(image, length));
+
+    to.setFrom(image, length);
+    partial.setFrom(image, length);
+
+    // Every block has reached the object with its key, indexed or not
+    for (std::size_t i = 0; i < OBJECTS; i++) {
+        assert(target[i]->isConfigured());
+        assert(target[i]->configuration().gain == static_cast<float>(i));
+        assert(target[i]->configuration().table[3] == i * 1000);
+    }
+
+    // The blocks are in registration order: the first unknown one stops the loading
+    for (std::size_t i = 0; i < OBJECTS; i++) {
+        assert(other[i]->isConfigured() == (i < INDEXED));
+        assert(!other[i]->isConfigured() || (other[i]->configuration().gain == static_cast<float>(i)));
+    }
+
+    printf("CoreConfigurationManager: OK\n");
+    return 0;
+} // main
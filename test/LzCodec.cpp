@@ -0,0 +1,152 @@
+/* COPYRIGHT (c) 2016-2018 Nova Labs SRL
+ *
+ * All rights reserved. All use of this software and documentation is
+ * subject to the License Agreement located in the file LICENSE.
+ */
+
+/* Host test: LzEncoder -> LzDecoder round trip.
+ *
+ * g++ -std=c++11 -I include test/LzCodec.cpp src/LzCodec.cpp -o lzcodec_test && ./lzcodec_test
+ */
+
+#include <core/mw/LzCodec.hpp>
+
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+using core::mw::LzCodec;
+using core::mw::LzEncoder;
+using core::mw::LzDecoder;
+
+struct Matches {
+    std::size_t window;
+    std::size_t overlapping;
+};
+
+// Walk the stream format, counting the matches that reach back exactly WINDOW bytes, and those longer than their offset
+static Matches
+scan(
+    const std::vector<uint8_t>& stream
+)
+{
+    Matches     matches = {0, 0};
+    std::size_t i       = 0;
+
+    while (i < stream.size()) {
+        uint8_t flags = stream[i++];
+
+        for (std::size_t item = 0; (item < 8) && (i < stream.size()); item++) {
+            if (flags & (1 << item)) {
+                std::size_t offset = (stream[i] | ((stream[i + 1] & 0x03) << 8)) + 1;
+                std::size_t length = (stream[i + 1] >> 2) + LzCodec::MIN_MATCH;
+
+                matches.window      += (offset == LzCodec::WINDOW);
+                matches.overlapping += (length > offset);
+                i += 2;
+            } else {
+                i++;
+            }
+        }
+    }
+
+    return matches;
+} // scan
+
+static Matches
+roundtrip(
+    const std::vector<uint8_t>& input,
+    std::size_t                 chunk
+)
+{
+    static LzEncoder encoder;
+    static LzDecoder decoder;
+
+    std::vector<uint8_t> stream;
+    std::vector<uint8_t> buffer(chunk);
+    std::size_t          n;
+
+    encoder.reset(input.data(), input.size());
+
+    while ((n = encoder.encode(buffer.data(), buffer.size())) > 0) {
+        stream.insert(stream.end(), buffer.begin(), buffer.begin() + n);
+    }
+
+    // Feed the decoder in chunks too, into an output buffer of a different size
+    std::vector<uint8_t> output;
+    const uint8_t*       in = stream.data();
+    std::size_t          left = stream.size();
+
+    decoder.reset();
+    buffer.resize(chunk + 7);
+
+    while ((n = decoder.decode(in, left, buffer.data(), buffer.size())) > 0) {
+        output.insert(output.end(), buffer.begin(), buffer.begin() + n);
+    }
+
+    assert(left == 0);
+    assert(output == input);
+
+    return scan(stream);
+} // roundtrip
+
+int
+main()
+{
+    std::vector<uint8_t> input;
+
+    // Empty input
+    roundtrip(input, 16);
+
+    // Incompressible data
+    srand(1);
+
+    for (std::size_t i = 0; i < 5000; i++) {
+        input.push_back(static_cast<uint8_t>(rand()));
+    }
+
+    roundtrip(input, 1);
+    roundtrip(input, 64);
+
+    // Runs: matches longer than their offset
+    input.clear();
+
+    for (std::size_t i = 0; i < 3000; i++) {
+        input.push_back(static_cast<uint8_t>((i / 500) & 1 ? 0xFF : (i % 3)));
+    }
+
+    Matches matches = roundtrip(input, 13);
+    assert(matches.overlapping > 0);
+
+    // A random block repeated with a period of exactly WINDOW: matches at offset == WINDOW
+    input.clear();
+
+    for (std::size_t i = 0; i < LzCodec::WINDOW; i++) {
+        input.push_back(static_cast<uint8_t>(rand()));
+    }
+
+    for (std::size_t i = 0; i < 3 * LzCodec::WINDOW; i++) {
+        input.push_back(input[i]);
+    }
+
+    matches = roundtrip(input, 17);
+    assert(matches.window > 0);
+
+    // Same, with the period crossing the window edge and runs in the block, so overlapping matches are at WINDOW - 1
+    input.resize(LzCodec::WINDOW);
+
+    for (std::size_t i = 100; i < 300; i++) {
+        input[i] = 0x55;
+    }
+
+    for (std::size_t i = 0; i < 2 * LzCodec::WINDOW; i++) {
+        input.push_back(input[i + 1]);
+    }
+
+    matches = roundtrip(input, 256);
+    assert(matches.overlapping > 0);
+
+    printf("LzCodec: OK\n");
+    return 0;
+} // main
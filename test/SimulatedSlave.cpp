@@ -0,0 +1,706 @@
+/* COPYRIGHT (c) 2016-2018 Nova Labs SRL
+ *
+ * All rights reserved. All use of this software and documentation is
+ * subject to the License Agreement located in the file LICENSE.
+ */
+
+#include "SimulatedSlave.hpp"
+
+#include <core/mw/StackProfiler.hpp>
+#include <core/mw/Checksummer.hpp>
+
+#include <algorithm>
+
+NAMESPACE_CORE_MW_BEGIN
+
+namespace bootloader {
+static const uint8_t PROTOCOL_VERSION = 3;
+
+// Payloads follow a 2 bytes header: copy them out, instead of casting
+template <typename PAYLOAD>
+static PAYLOAD
+payload_of(
+    const BootMsg& msg
+)
+{
+    PAYLOAD tmp;
+
+    memcpy(&tmp, msg.data, sizeof(tmp));
+    return tmp;
+}
+
+static bool
+hex_byte(
+    const char* string,
+    uint8_t&    value
+)
+{
+    value = 0;
+
+    for (std::size_t i = 0; i < 2; i++) {
+        char c = string[i];
+
+        if ((c >= '0') && (c <= '9')) {
+            value = (value << 4) | (c - '0');
+        } else if ((c >= 'A') && (c <= 'F')) {
+            value = (value << 4) | (c - 'A' + 10);
+        } else if ((c >= 'a') && (c <= 'f')) {
+            value = (value << 4) | (c - 'a' + 10);
+        } else {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+SimulatedSlave::SimulatedSlave(
+    ModuleUID       uid,
+    const char*     module_type,
+    const char*     module_name,
+    Flasher::PageID first_page,
+    std::size_t     pages
+) : _uid(uid), _first_page(first_page), _pages(pages), _random(uid), _node("bootsim", false), _thread(nullptr), _run(false),
+    _flasher(_page_buffers[0], _page_buffers[1]), _selected(false), _transfer(Transfer::NONE), _ihex_base(0),
+    _image_address(0), _image_length(0), _image_crc(0), _stream_offset(0), _decoded(0)
+{
+    CORE_ASSERT((first_page + pages) * Flasher::PAGE_SIZE <= Flasher::get_program_length());
+
+    _module_type.fill(0);
+    _module_type = module_type;
+    _module_name.fill(0);
+    _module_name = module_name;
+    _link.latency = core::os::Time::IMMEDIATE;
+    _link.loss    = 0;
+
+    memset(_blocks, 0, sizeof(_blocks));
+}
+
+void
+SimulatedSlave::setLink(
+    const Link& link
+)
+{
+    _link = link;
+}
+
+bool
+SimulatedSlave::start()
+{
+    _run    = true;
+    _thread = StackProfiler::create_heap(2048, core::os::Thread::PriorityEnum::NORMAL, [](void* arg) {
+        reinterpret_cast<SimulatedSlave*>(arg)->code();
+    }, this, "bootsim");
+
+    return _thread != nullptr;
+}
+
+bool
+SimulatedSlave::stop()
+{
+    if (_thread == nullptr) {
+        return false;
+    }
+
+    _run = false;
+
+    core::os::Thread::join(*_thread);
+    StackProfiler::release(_thread);
+    _thread = nullptr;
+
+    return true;
+}
+
+ModuleUID
+SimulatedSlave::uid() const
+{
+    return _uid;
+}
+
+const uint8_t*
+SimulatedSlave::program() const
+{
+    return Flasher::address_of(_first_page);
+}
+
+std::size_t
+SimulatedSlave::programSize() const
+{
+    return _pages * Flasher::PAGE_SIZE;
+}
+
+void
+SimulatedSlave::code()
+{
+    const core::os::Time ANNOUNCE_PERIOD = core::os::Time::ms(250);
+
+    BootMsg*       msgp;
+    core::os::Time announced = core::os::Time::now() - ANNOUNCE_PERIOD;
+
+    _node.advertise(_pub, BOOTLOADER_TOPIC_NAME);
+    _node.advertise(_announce, BOOTLOADER_MASTER_TOPIC_NAME);
+    _node.subscribe(_sub, BOOTLOADER_TOPIC_NAME);
+    _node.set_enabled(true);
+
+    while (_run) {
+        if (_node.spin(core::os::Time::ms(50))) {
+            while (_sub.fetch(msgp)) {
+                // The acks of this slave, and the ones of the others, are on the same topic
+                if ((msgp->command != MessageType::ACK) && (msgp->command != MessageType::DESCRIPTION) && !lost()) {
+                    if (_link.latency != core::os::Time::IMMEDIATE) {
+                        core::os::Thread::sleep(_link.latency);
+                    }
+
+                    handle(*msgp);
+                }
+
+                _sub.release(*msgp);
+            }
+        }
+
+        // Until a master picks it up
+        if (!_selected && (core::os::Time::now() - announced >= ANNOUNCE_PERIOD)) {
+            announce();
+            announced = core::os::Time::now();
+        }
+    }
+
+    if (_transfer != Transfer::NONE) {
+        _flasher.end();
+        _transfer = Transfer::NONE;
+    }
+
+    _node.set_enabled(false);
+} // SimulatedSlave::code
+
+bool
+SimulatedSlave::lost()
+{
+    if (_link.loss == 0) {
+        return false;
+    }
+
+    _random = _random * 1103515245u + 12345u;
+
+    return ((_random >> 16) % 1000) < _link.loss;
+}
+
+uint8_t*
+SimulatedSlave::pointer(
+    uint32_t address,
+    uint32_t length
+) const
+{
+    if ((address < BASE_ADDRESS) || (address - BASE_ADDRESS > programSize()) || (length > programSize() - (address - BASE_ADDRESS))) {
+        return nullptr;
+    }
+
+    return const_cast<uint8_t*>(program()) + (address - BASE_ADDRESS);
+}
+
+bool
+SimulatedSlave::addressed(
+    const BootMsg& msg
+) const
+{
+    return payload_of<payload::UID>(msg).uid == _uid;
+}
+
+void
+SimulatedSlave::acknowledge(
+    const BootMsg&    msg,
+    AcknowledgeStatus status,
+    const void*       data,
+    std::size_t       length
+)
+{
+    BootMsg* msgp;
+
+    if (lost() || !_pub.alloc(msgp)) {
+        return;
+    }
+
+    CORE_WARNINGS_NO_CAST_ALIGN
+    AcknowledgeMsg* ack = reinterpret_cast<AcknowledgeMsg*>(msgp);
+    CORE_WARNINGS_RESET
+
+    CORE_ASSERT(length <= AcknowledgeMsg::DATA_LENGTH);
+
+    ack->command    = MessageType::ACK;
+    ack->sequenceId = msg.sequenceId + 1;
+    ack->status     = status;
+    ack->type       = msg.command;
+    memset(ack->data, 0, sizeof(ack->data));
+
+    if (length > 0) {
+        memcpy(ack->data, data, length);
+    }
+
+    _pub.publish(*msgp);
+} // SimulatedSlave::acknowledge
+
+void
+SimulatedSlave::describe(
+    payload::DescribeV3& description
+) const
+{
+    memset(&description, 0, sizeof(description));
+
+    description.programFlashSize = programSize();
+    description.userFlashSize    = 0;
+    description.tagsFlashSize    = 0;
+    description.programValid     = 1;
+    description.userValid        = 0;
+    description.moduleId         = 0;
+    description.moduleType       = _module_type;
+    description.moduleName       = _module_name;
+}
+
+void
+SimulatedSlave::announce()
+{
+    BootMasterMsg* msgp;
+
+    if (!_announce.alloc(msgp)) {
+        return;
+    }
+
+    msgp->command    = MessageType::REQUEST;
+    msgp->sequenceId = 0;
+
+    // The announce does not fit the short message as a whole: only uid and version are sent (as the master reads them)
+    CORE_WARNINGS_NO_CAST_ALIGN
+    payload::Announce* tmp = reinterpret_cast<payload::Announce*>(&msgp->data);
+    CORE_WARNINGS_RESET
+
+    tmp->uid     = _uid;
+    tmp->version = PROTOCOL_VERSION;
+
+    _announce.publish(*msgp);
+}
+
+void
+SimulatedSlave::flush()
+{
+    // What has been received so far gets programmed, before the flash is read back
+    if (_transfer != Transfer::NONE) {
+        _flasher.end();
+        _flasher.begin();
+    }
+}
+
+void
+SimulatedSlave::handle(
+    const BootMsg& msg
+)
+{
+    switch (msg.command) {
+      case MessageType::SELECT_SLAVE:
+          if (addressed(msg)) {
+              _selected = true;
+              acknowledge(msg, AcknowledgeStatus::OK);
+          }
+
+          return;
+
+      case MessageType::DESELECT_SLAVE:
+          if (payload_of<payload::UID>(msg).uid == 0xFFFFFFFF) {
+              _selected = false; // All the slaves: nobody answers
+          } else if (addressed(msg)) {
+              _selected = false;
+              acknowledge(msg, AcknowledgeStatus::OK);
+          }
+
+          return;
+
+      case MessageType::IDENTIFY_SLAVE:
+          if (addressed(msg)) {
+              acknowledge(msg, AcknowledgeStatus::OK);
+          }
+
+          return;
+
+      case MessageType::DESCRIBE_ALL: {
+          // Selected or not, and not an acknowledge
+          BootMsg* msgp;
+
+          if (!lost() && _pub.alloc(msgp)) {
+              payload::Description description;
+
+              description.uid = _uid;
+              describe(description.description);
+
+              msgp->command    = MessageType::DESCRIPTION;
+              msgp->sequenceId = msg.sequenceId + 1;
+              memset(msgp->data, 0, sizeof(msgp->data));
+              memcpy(msgp->data, &description, sizeof(description));
+
+              _pub.publish(*msgp);
+          }
+      }
+          return;
+
+      case MessageType::RESET_ALL:
+          _selected = false;
+          _transfer = Transfer::NONE;
+          return;
+
+      case MessageType::IHEX_WRITE:
+      case MessageType::BLOCK_WRITE:
+          // No uid: for all the selected slaves
+          break;
+
+      default:
+          if (!addressed(msg)) {
+              return;
+          }
+    } // switch
+
+    if (!_selected) {
+        return;
+    }
+
+    switch (msg.command) {
+      case MessageType::DESCRIBE_V3: {
+          payload::DescribeV3 description;
+
+          describe(description);
+          acknowledge(msg, AcknowledgeStatus::OK, &description, sizeof(description));
+      }
+          break;
+
+      case MessageType::ERASE_PROGRAM:
+          acknowledge(msg, eraseProgram() ? AcknowledgeStatus::OK : AcknowledgeStatus::ERROR);
+          break;
+
+      case MessageType::ERASE_CONFIGURATION:
+      case MessageType::ERASE_USER_CONFIGURATION:
+      case MessageType::WRITE_PROGRAM_CRC:
+      case MessageType::WRITE_MODULE_CAN_ID:
+          acknowledge(msg, AcknowledgeStatus::OK); // Nothing to keep
+          break;
+
+      case MessageType::WRITE_MODULE_NAME:
+          _module_name = payload_of<payload::UIDAndName>(msg).name;
+          acknowledge(msg, AcknowledgeStatus::OK);
+          break;
+
+      case MessageType::IHEX_WRITE:
+          acknowledge(msg, writeIHex(payload_of<payload::IHex>(msg)) ? AcknowledgeStatus::OK : AcknowledgeStatus::ERROR);
+          break;
+
+      case MessageType::BLOCK_BEGIN:
+          _flasher.end();
+          _flasher.begin();
+          _transfer = Transfer::BLOCKS;
+          memset(_blocks, 0, sizeof(_blocks));
+          acknowledge(msg, AcknowledgeStatus::OK);
+          break;
+
+      case MessageType::BLOCK_BEGIN_COMPRESSED: {
+          payload::CompressedImage image = payload_of<payload::CompressedImage>(msg);
+
+          if (pointer(image.address, image.length) == nullptr) {
+              acknowledge(msg, AcknowledgeStatus::ERROR);
+              break;
+          }
+
+          _flasher.end();
+          _flasher.begin();
+          _transfer      = Transfer::COMPRESSED;
+          _image_address = image.address;
+          _image_length  = image.length;
+          _image_crc     = image.crc;
+          _stream_offset = 0;
+          _decoded       = 0;
+          _decoder.reset();
+          acknowledge(msg, AcknowledgeStatus::OK);
+      }
+          break;
+
+      case MessageType::BLOCK_WRITE: {
+          payload::Block block = payload_of<payload::Block>(msg);
+
+          if ((_transfer != Transfer::BLOCKS) && (_transfer != Transfer::COMPRESSED)) {
+              break;
+          }
+
+          AcknowledgeStatus status = writeBlock(block);
+
+          if ((status != AcknowledgeStatus::DO_NOT_ACK) && ((block.flags & payload::Block::NO_ACK) == 0)) {
+              payload::BlockAck ack;
+
+              ack.index = block.index;
+              acknowledge(msg, status, &ack, sizeof(ack));
+          }
+      }
+          break;
+
+      case MessageType::BLOCK_END:
+          acknowledge(msg, endTransfer(payload_of<payload::UIDAndCount>(msg).count) ? AcknowledgeStatus::OK : AcknowledgeStatus::ERROR);
+          break;
+
+      case MessageType::BLOCK_STATUS: {
+          payload::BlockBitmap bitmap;
+
+          flush();
+          blockBitmap(payload_of<payload::UIDAndIndex>(msg).index, bitmap);
+          acknowledge(msg, AcknowledgeStatus::OK, &bitmap, sizeof(bitmap));
+      }
+          break;
+
+      case MessageType::PAGE_CRC: {
+          uint32_t         address = payload_of<payload::UIDAndAddress>(msg).address;
+          payload::PageCRC crcs;
+
+          if (pointer(address, 1) == nullptr) {
+              acknowledge(msg, AcknowledgeStatus::ERROR);
+              break;
+          }
+
+          flush();
+          pageCRC(address, crcs);
+          acknowledge(msg, AcknowledgeStatus::OK, &crcs, sizeof(crcs));
+      }
+          break;
+
+      case MessageType::ERASE_PAGE: {
+          uint32_t address = payload_of<payload::UIDAndAddress>(msg).address;
+          uint8_t* page    = pointer(address - ((address - BASE_ADDRESS) % Flasher::PAGE_SIZE), Flasher::PAGE_SIZE);
+
+          acknowledge(msg, ((page != nullptr) && _flasher.erase(page, Flasher::PAGE_SIZE)) ? AcknowledgeStatus::OK : AcknowledgeStatus::ERROR);
+      }
+          break;
+
+      case MessageType::RESET:
+          acknowledge(msg, AcknowledgeStatus::OK);
+          _flasher.end();
+          _selected = false;
+          _transfer = Transfer::NONE;
+          break;
+
+      default:
+          acknowledge(msg, AcknowledgeStatus::NOT_IMPLEMENTED);
+          break;
+    } // switch
+} // SimulatedSlave::handle
+
+bool
+SimulatedSlave::eraseProgram()
+{
+    if (_transfer != Transfer::NONE) {
+        _flasher.end();
+        _transfer = Transfer::NONE;
+    }
+
+    for (std::size_t i = 0; i < _pages; i++) {
+        if (!Flasher::erase(static_cast<Flasher::PageID>(_first_page + i))) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool
+SimulatedSlave::writeIHex(
+    const payload::IHex& ihex
+)
+{
+    switch (ihex.type) {
+      case payload::IHex::Type::BEGIN:
+          _flasher.end();
+          _flasher.begin();
+          _transfer  = Transfer::IHEX;
+          _ihex_base = 0;
+          return true;
+
+      case payload::IHex::Type::END:
+          _transfer = Transfer::NONE;
+          return _flasher.end();
+
+      case payload::IHex::Type::DATA:
+          break;
+
+      default:
+          return false;
+    }
+
+    if (_transfer != Transfer::IHEX) {
+        return false;
+    }
+
+    // length, address (2), type, data, checksum: the whole record must fit the string
+    uint8_t record[(sizeof(payload::IHex::Data) - 1) / 2];
+
+    if ((ihex.string[0] != ':') || !hex_byte(ihex.string + 1, record[0]) || (1 + 2 * (1 + 2 + 1 + static_cast<std::size_t>(record[0]) + 1) > sizeof(ihex.string))) {
+        return false;
+    }
+
+    std::size_t n   = 1 + 2 + 1 + record[0] + 1;
+    uint8_t     sum = record[0];
+
+    for (std::size_t i = 1; i < n; i++) {
+        if (!hex_byte(ihex.string + 1 + 2 * i, record[i])) {
+            return false;
+        }
+
+        sum += record[i];
+    }
+
+    if (sum != 0) {
+        return false;
+    }
+
+    uint32_t offset = (record[1] << 8) | record[2];
+    uint32_t value  = (record[4] << 8) | record[5];
+
+    switch (record[3]) {
+      case 0x00: { // Data
+          uint8_t* address = pointer(_ihex_base + offset, record[0]);
+
+          return (address != nullptr) && _flasher.flash(address, &record[4], record[0]);
+      }
+
+      case 0x02: // Extended segment address
+          _ihex_base = value << 4;
+          return record[0] == 2;
+
+      case 0x04: // Extended linear address
+          _ihex_base = value << 16;
+          return record[0] == 2;
+
+      case 0x01: // End of file
+      case 0x03: // Start segment address
+      case 0x05: // Start linear address
+          return true;
+
+      default:
+          return false;
+    } // switch
+} // SimulatedSlave::writeIHex
+
+AcknowledgeStatus
+SimulatedSlave::writeBlock(
+    const payload::Block& block
+)
+{
+    if (block.length > payload::Block::SIZE) {
+        return AcknowledgeStatus::ERROR;
+    }
+
+    if (_transfer == Transfer::BLOCKS) {
+        uint8_t* address = pointer(block.address, block.length);
+
+        if ((address == nullptr) || !_flasher.flash(address, block.data, block.length)) {
+            return AcknowledgeStatus::ERROR;
+        }
+
+        if (block.index < SIMULATED_SLAVE_MAX_BLOCKS) {
+            _blocks[block.index / 8] |= 1 << (block.index % 8);
+        }
+
+        return AcknowledgeStatus::OK;
+    }
+
+    // Compressed: the address is the offset in the stream, which is decoded in order
+    if (block.address > _stream_offset) {
+        return AcknowledgeStatus::DO_NOT_ACK; // Missing the previous ones: dropped, it is sent again on its timeout
+    }
+
+    if (block.address + block.length <= _stream_offset) {
+        return AcknowledgeStatus::OK; // Sent again, already decoded
+    }
+
+    const uint8_t* in     = block.data + (_stream_offset - block.address);
+    std::size_t    length = block.address + block.length - _stream_offset;
+    uint8_t        out[payload::Block::SIZE];
+
+    _stream_offset = block.address + block.length;
+
+    while ((length > 0) && (_decoded < _image_length)) {
+        std::size_t n = _decoder.decode(in, length, out, std::min(sizeof(out), static_cast<std::size_t>(_image_length - _decoded)));
+
+        if (n == 0) {
+            break;
+        }
+
+        if (!_flasher.flash(pointer(_image_address + _decoded, n), out, n)) {
+            return AcknowledgeStatus::ERROR;
+        }
+
+        _decoded += n;
+    }
+
+    return AcknowledgeStatus::OK;
+} // SimulatedSlave::writeBlock
+
+bool
+SimulatedSlave::endTransfer(
+    uint16_t count
+)
+{
+    Transfer transfer = _transfer;
+    bool     success  = _flasher.end();
+
+    _transfer = Transfer::NONE;
+
+    switch (transfer) {
+      case Transfer::BLOCKS:
+          if (count > SIMULATED_SLAVE_MAX_BLOCKS) {
+              return false;
+          }
+
+          for (std::size_t i = 0; i < count; i++) {
+              success &= (_blocks[i / 8] & (1 << (i % 8))) != 0;
+          }
+
+          return success;
+
+      case Transfer::COMPRESSED:
+          return success && (_decoded == _image_length) && (CRC32::compute(pointer(_image_address, _image_length), _image_length) == _image_crc);
+
+      default:
+          return false;
+    }
+} // SimulatedSlave::endTransfer
+
+void
+SimulatedSlave::pageCRC(
+    uint32_t          address,
+    payload::PageCRC& crcs
+)
+{
+    std::size_t first = (address - BASE_ADDRESS) / Flasher::PAGE_SIZE;
+
+    memset(&crcs, 0, sizeof(crcs));
+
+    crcs.address  = BASE_ADDRESS + first * Flasher::PAGE_SIZE;
+    crcs.pageSize = Flasher::PAGE_SIZE;
+    crcs.count    = static_cast<uint8_t>(std::min(payload::PageCRC::MAX_COUNT, _pages - first));
+
+    for (std::size_t i = 0; i < crcs.count; i++) {
+        crcs.crc[i] = CRC32::compute(Flasher::address_of(static_cast<Flasher::PageID>(_first_page + first + i)), Flasher::PAGE_SIZE);
+    }
+}
+
+void
+SimulatedSlave::blockBitmap(
+    uint16_t              first,
+    payload::BlockBitmap& bitmap
+) const
+{
+    bitmap.first = first;
+    memset(bitmap.bits, 0, sizeof(bitmap.bits));
+
+    for (std::size_t bit = 0; bit < payload::BlockBitmap::BITS; bit++) {
+        std::size_t index = first + bit;
+
+        if ((index < SIMULATED_SLAVE_MAX_BLOCKS) && (_blocks[index / 8] & (1 << (index % 8)))) {
+            bitmap.bits[bit / 8] |= 1 << (bit % 8);
+        }
+    }
+}
+}
+
+NAMESPACE_CORE_MW_END
@@ -0,0 +1,198 @@
+/* COPYRIGHT (c) 2016-2018 Nova Labs SRL
+ *
+ * All rights reserved. All use of this software and documentation is
+ * subject to the License Agreement located in the file LICENSE.
+ */
+
+#pragma once
+
+#include <core/mw/namespace.hpp>
+#include <core/common.hpp>
+#include <core/mw/Middleware.hpp>
+#include <core/mw/BootMsg.hpp>
+#include <core/mw/Flasher.hpp>
+#include <core/mw/LzCodec.hpp>
+#include <core/os/Thread.hpp>
+
+//! Highest block index a simulated slave keeps track of (see payload::BlockBitmap)
+#ifndef SIMULATED_SLAVE_MAX_BLOCKS
+#define SIMULATED_SLAVE_MAX_BLOCKS 4096
+#endif
+
+//! Incoming messages queue: a window of blocks and commands, and the own acknowledges
+#ifndef SIMULATED_SLAVE_QUEUE_LENGTH
+#define SIMULATED_SLAVE_QUEUE_LENGTH 24
+#endif
+
+NAMESPACE_CORE_MW_BEGIN
+
+namespace bootloader {
+/*! \brief Simulated bootloader slave
+ *
+ * Speaks the slave side of the BootMsg protocol, on the same middleware as the BootloaderMaster
+ * (which must be built with BOOTLOADER_MASTER_LOCAL_SLAVES), and programs a range of pages of a RAM backed Flasher.
+ * Each slave of a test must get its own range.
+ *
+ * The link can delay and lose messages, both ways; erase and program times are set on the flash (see Flasher_::set_timing()).
+ *
+ * Supported: selection, DESCRIBE_V3 and DESCRIBE_ALL, program erase, Intel HEX and binary (plain, multicast, compressed) transfers,
+ * page CRCs and erase. The slave has no configuration, user flash, or tags.
+ */
+class SimulatedSlave:
+    private core::Uncopyable
+{
+public:
+    /*! \brief Link impairments
+     */
+    struct Link {
+        core::os::Time latency; //!< delay before a command is handled
+        uint16_t       loss;    //!< messages lost, both ways, per 1000
+    };
+
+    SimulatedSlave(
+        ModuleUID       uid,
+        const char*     module_type,
+        const char*     module_name,
+        Flasher::PageID first_page, //!< [in] first page of the program
+        std::size_t     pages //!< [in] program size, in pages
+    );
+
+    void
+    setLink(
+        const Link& link
+    );
+
+    bool
+    start();
+
+    bool
+    stop();
+
+    ModuleUID
+    uid() const;
+
+    /*! \brief The program, as currently programmed
+     *
+     * It is the program from BASE_ADDRESS on: Flasher::BASE_ADDRESS on the bus.
+     */
+    const uint8_t*
+    program() const;
+
+    std::size_t
+    programSize() const;
+
+private:
+    static const uint32_t BASE_ADDRESS = Flasher::BASE_ADDRESS;
+
+    enum class Transfer : uint8_t {
+        NONE,
+        IHEX,
+        BLOCKS,
+        COMPRESSED
+    };
+
+    ModuleUID       _uid;
+    ModuleType      _module_type;
+    ModuleName      _module_name;
+    Flasher::PageID _first_page;
+    std::size_t     _pages;
+    Link            _link;
+    uint32_t        _random;
+
+    core::mw::Node                _node;
+    core::mw::Publisher<BootMsg>  _pub;
+    core::mw::Subscriber<BootMsg, SIMULATED_SLAVE_QUEUE_LENGTH> _sub;
+    core::mw::Publisher<BootMasterMsg> _announce;
+    core::os::Thread* _thread;
+    volatile bool     _run;
+
+    Flasher::Data _page_buffers[2][Flasher::PAGE_SIZE / sizeof(Flasher::Data)] CORE_FLASH_ALIGNED;
+    Flasher       _flasher;
+    LzDecoder     _decoder;
+
+    bool     _selected;
+    Transfer _transfer;
+    uint32_t _ihex_base;
+    uint8_t  _blocks[SIMULATED_SLAVE_MAX_BLOCKS / 8];
+
+    // Compressed transfer
+    uint32_t _image_address;
+    uint32_t _image_length;
+    uint32_t _image_crc;
+    uint32_t _stream_offset; //!< next stream byte expected
+    uint32_t _decoded; //!< image bytes programmed
+
+    void
+    code();
+
+    bool
+    lost();
+
+    uint8_t*
+    pointer(
+        uint32_t address,
+        uint32_t length
+    ) const;
+
+    bool
+    addressed(
+        const BootMsg& msg
+    ) const;
+
+    void
+    handle(
+        const BootMsg& msg
+    );
+
+    void
+    acknowledge(
+        const BootMsg&    msg,
+        AcknowledgeStatus status,
+        const void*       data = nullptr,
+        std::size_t       length = 0
+    );
+
+    void
+    describe(
+        payload::DescribeV3& description
+    ) const;
+
+    void
+    announce();
+
+    void
+    flush();
+
+    bool
+    eraseProgram();
+
+    bool
+    writeIHex(
+        const payload::IHex& ihex
+    );
+
+    AcknowledgeStatus
+    writeBlock(
+        const payload::Block& block
+    );
+
+    bool
+    endTransfer(
+        uint16_t count
+    );
+
+    void
+    pageCRC(
+        uint32_t          address,
+        payload::PageCRC& crcs
+    );
+
+    void
+    blockBitmap(
+        uint16_t              first,
+        payload::BlockBitmap& bitmap
+    ) const;
+};
+}
+
+NAMESPACE_CORE_MW_END
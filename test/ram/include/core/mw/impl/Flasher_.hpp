@@ -0,0 +1,206 @@
+/* COPYRIGHT (c) 2016-2018 Nova Labs SRL
+ *
+ * All rights reserved. All use of this software and documentation is
+ * subject to the License Agreement located in the file LICENSE.
+ */
+
+#pragma once
+
+#include <core/mw/namespace.hpp>
+#include <core/common.hpp>
+#include <core/os/Time.hpp>
+
+//! Size of the simulated flash, in pages
+#if !defined(CORE_FLASHER_RAM_PAGES) || defined(__DOXYGEN__)
+#define CORE_FLASHER_RAM_PAGES 256
+#endif
+
+NAMESPACE_CORE_MW_BEGIN
+
+/*! \brief Flash programming, RAM backend
+ *
+ * Simulates a page erasable flash in RAM, for tests on a host. As on a NOR flash, programming can only clear bits:
+ * a page is erased before it is written, if needed. Erasing and programming a page take the times set by set_timing().
+ *
+ * BASE_ADDRESS is the address of the first page, as seen by the users of the flash (e.g.: in the bootloader protocol).
+ * There is no RAM to jump to.
+ */
+class Flasher_:
+    private core::Uncopyable
+{
+public:
+    typedef uint32_t    Data;
+    typedef uint32_t    PageID;
+    typedef std::size_t Length;
+
+    enum {
+        BASE_ADDRESS = 0x08000000
+    };
+
+    enum {
+        PAGE_SIZE = 1024
+    };
+
+    enum {
+        PROGRAM_ALIGNMENT = 2
+    };
+
+    enum {
+        WORD_ALIGNMENT = 4
+    };
+
+    /*! \brief Flash operations counters
+     */
+    struct Statistics {
+        uint32_t erased;  //!< pages erased
+        uint32_t written; //!< pages programmed
+    };
+
+private:
+    Data*  _page_buffer;
+    PageID _page; //!< page staged into the buffer
+    bool   _staged;
+    bool   _error;
+
+public:
+    void
+    set_page_buffer(
+        Data page_buf[]
+    );
+
+    void
+    begin();
+
+    bool
+    end();
+
+    bool
+    flash_aligned(
+        const Data* address,
+        const Data* bufp,
+        size_t      buflen
+    );
+
+    bool
+    erase_aligned(
+        const Data* address,
+        size_t      length
+    );
+
+    bool
+    flash(
+        const uint8_t* address,
+        const uint8_t* bufp,
+        size_t         buflen
+    );
+
+    bool
+    erase(
+        const uint8_t* address,
+        size_t         length
+    );
+
+public:
+    Flasher_(
+        Data page_buf[]
+    );
+
+private:
+    bool
+    commit();
+
+public:
+    /*! \brief Time taken by erasing a page, and by programming a page
+     */
+    static void
+    set_timing(
+        core::os::Time erase,
+        core::os::Time program
+    );
+
+    static Statistics
+    statistics();
+
+    static bool
+    is_aligned(
+        const void* ptr
+    );
+
+    static bool
+    is_within_bounds(
+        const void* ptr
+    );
+
+    static bool
+    is_erased(
+        PageID page
+    );
+
+    static bool
+    erase(
+        PageID page
+    );
+
+    static int
+    compare(
+        PageID      page,
+        const Data* bufp
+    );
+
+    static bool
+    read(
+        PageID page,
+        Data*  bufp
+    );
+
+    static bool
+    write(
+        PageID      page,
+        const Data* bufp
+    );
+
+    static bool
+    write_if_needed(
+        PageID      page,
+        const Data* bufp
+    );
+
+    static const uint8_t*
+    address_of(
+        PageID page
+    );
+
+    static PageID
+    page_of(
+        const uint8_t* address
+    );
+
+    static const uint8_t*
+    align_prev(
+        const uint8_t* address
+    );
+
+    static const uint8_t*
+    align_next(
+        const uint8_t* address
+    );
+
+    static const uint8_t*
+    get_program_start();
+
+    static const uint8_t*
+    get_program_end();
+
+    static const uint8_t*
+    get_ram_start();
+
+    static const uint8_t*
+    get_ram_end();
+
+    static void
+    jump_to(
+        const uint8_t* address
+    );
+};
+
+NAMESPACE_CORE_MW_END
@@ -0,0 +1,386 @@
+/* COPYRIGHT (c) 2016-2018 Nova Labs SRL
+ *
+ * All rights reserved. All use of this software and documentation is
+ * subject to the License Agreement located in the file LICENSE.
+ */
+
+#include <core/mw/namespace.hpp>
+#include <core/mw/impl/Flasher_.hpp>
+#include <core/os/OS.hpp>
+#include <core/os/Thread.hpp>
+
+#include <algorithm>
+
+NAMESPACE_CORE_MW_BEGIN
+
+static const std::size_t PAGE_WORDS = Flasher_::PAGE_SIZE / sizeof(Flasher_::Data);
+
+static Flasher_::Data       _memory[CORE_FLASHER_RAM_PAGES * PAGE_WORDS];
+static core::os::Time       _erase_time;
+static core::os::Time       _program_time;
+static Flasher_::Statistics _statistics;
+
+// Flash comes out of the factory erased
+static struct Format {
+    Format()
+    {
+        std::fill(&_memory[0], &_memory[CORE_FLASHER_RAM_PAGES * PAGE_WORDS], 0xFFFFFFFF);
+    }
+} _format;
+
+static inline Flasher_::Data*
+words_of(
+    Flasher_::PageID page
+)
+{
+    return &_memory[page * PAGE_WORDS];
+}
+
+Flasher_::Flasher_(
+    Data page_buf[]
+) : _page_buffer(page_buf), _page(0), _staged(false), _error(false)
+{}
+
+void
+Flasher_::set_page_buffer(
+    Data page_buf[]
+)
+{
+    _page_buffer = page_buf;
+    _staged      = false;
+}
+
+void
+Flasher_::begin()
+{
+    _staged = false;
+    _error  = false;
+}
+
+bool
+Flasher_::end()
+{
+    return commit() && !_error;
+}
+
+bool
+Flasher_::commit()
+{
+    if (!_staged) {
+        return true;
+    }
+
+    _staged = false;
+
+    if (!write_if_needed(_page, _page_buffer)) {
+        _error = true;
+        return false;
+    }
+
+    return true;
+}
+
+bool
+Flasher_::flash(
+    const uint8_t* address,
+    const uint8_t* bufp,
+    size_t         buflen
+)
+{
+    while (buflen > 0) {
+        if (!is_within_bounds(address)) {
+            return false;
+        }
+
+        PageID page = page_of(address);
+
+        if (!_staged || (_page != page)) {
+            if (!commit()) {
+                return false;
+            }
+
+            // Bytes not flashed keep their current contents
+            read(page, _page_buffer);
+            _page   = page;
+            _staged = true;
+        }
+
+        std::size_t offset = address - address_of(page);
+        std::size_t length = std::min(buflen, static_cast<std::size_t>(PAGE_SIZE) - offset);
+
+        memcpy(reinterpret_cast<uint8_t*>(_page_buffer) + offset, bufp, length);
+
+        address += length;
+        bufp    += length;
+        buflen  -= length;
+    }
+
+    return true;
+} // Flasher_::flash
+
+bool
+Flasher_::flash_aligned(
+    const Data* address,
+    const Data* bufp,
+    size_t      buflen
+)
+{
+    return flash(reinterpret_cast<const uint8_t*>(address), reinterpret_cast<const uint8_t*>(bufp), buflen);
+}
+
+bool
+Flasher_::erase(
+    const uint8_t* address,
+    size_t         length
+)
+{
+    if (!commit()) {
+        return false;
+    }
+
+    if (length == 0) {
+        return true;
+    }
+
+    if (!is_within_bounds(address) || !is_within_bounds(address + length - 1)) {
+        return false;
+    }
+
+    for (PageID page = page_of(address); page <= page_of(address + length - 1); page++) {
+        if (!erase(page)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool
+Flasher_::erase_aligned(
+    const Data* address,
+    size_t      length
+)
+{
+    return erase(reinterpret_cast<const uint8_t*>(address), length);
+}
+
+void
+Flasher_::set_timing(
+    core::os::Time erase,
+    core::os::Time program
+)
+{
+    core::os::SysLock::Scope lock;
+
+    _erase_time   = erase;
+    _program_time = program;
+}
+
+Flasher_::Statistics
+Flasher_::statistics()
+{
+    core::os::SysLock::Scope lock;
+
+    return _statistics;
+}
+
+bool
+Flasher_::is_aligned(
+    const void* ptr
+)
+{
+    return (reinterpret_cast<uintptr_t>(ptr) % WORD_ALIGNMENT) == 0;
+}
+
+bool
+Flasher_::is_within_bounds(
+    const void* ptr
+)
+{
+    return (ptr >= get_program_start()) && (ptr < get_program_end());
+}
+
+bool
+Flasher_::is_erased(
+    PageID page
+)
+{
+    const Data* words = words_of(page);
+
+    return std::all_of(words, words + PAGE_WORDS, [](Data word) {
+        return word == 0xFFFFFFFF;
+    });
+}
+
+bool
+Flasher_::erase(
+    PageID page
+)
+{
+    if (page >= CORE_FLASHER_RAM_PAGES) {
+        return false;
+    }
+
+    core::os::Time time;
+
+    {
+        core::os::SysLock::Scope lock;
+
+        time = _erase_time;
+        _statistics.erased++;
+    }
+
+    if (time != core::os::Time::IMMEDIATE) {
+        core::os::Thread::sleep(time);
+    }
+
+    std::fill(words_of(page), words_of(page) + PAGE_WORDS, 0xFFFFFFFF);
+
+    return true;
+}
+
+int
+Flasher_::compare(
+    PageID      page,
+    const Data* bufp
+)
+{
+    return memcmp(words_of(page), bufp, PAGE_SIZE);
+}
+
+bool
+Flasher_::read(
+    PageID page,
+    Data*  bufp
+)
+{
+    if (page >= CORE_FLASHER_RAM_PAGES) {
+        return false;
+    }
+
+    memcpy(bufp, words_of(page), PAGE_SIZE);
+
+    return true;
+}
+
+bool
+Flasher_::write(
+    PageID      page,
+    const Data* bufp
+)
+{
+    if (page >= CORE_FLASHER_RAM_PAGES) {
+        return false;
+    }
+
+    Data* words = words_of(page);
+
+    // Programming only clears bits: setting any of them back needs an erase
+    for (std::size_t i = 0; i < PAGE_WORDS; i++) {
+        if ((words[i] & bufp[i]) != bufp[i]) {
+            if (!erase(page)) {
+                return false;
+            }
+
+            break;
+        }
+    }
+
+    core::os::Time time;
+
+    {
+        core::os::SysLock::Scope lock;
+
+        time = _program_time;
+        _statistics.written++;
+    }
+
+    if (time != core::os::Time::IMMEDIATE) {
+        core::os::Thread::sleep(time);
+    }
+
+    for (std::size_t i = 0; i < PAGE_WORDS; i++) {
+        words[i] &= bufp[i];
+    }
+
+    return compare(page, bufp) == 0;
+} // Flasher_::write
+
+bool
+Flasher_::write_if_needed(
+    PageID      page,
+    const Data* bufp
+)
+{
+    if (compare(page, bufp) == 0) {
+        return true;
+    }
+
+    return write(page, bufp);
+}
+
+const uint8_t*
+Flasher_::address_of(
+    PageID page
+)
+{
+    return reinterpret_cast<const uint8_t*>(words_of(page));
+}
+
+Flasher_::PageID
+Flasher_::page_of(
+    const uint8_t* address
+)
+{
+    return static_cast<PageID>((address - get_program_start()) / PAGE_SIZE);
+}
+
+const uint8_t*
+Flasher_::align_prev(
+    const uint8_t* address
+)
+{
+    return reinterpret_cast<const uint8_t*>(reinterpret_cast<uintptr_t>(address) & ~static_cast<uintptr_t>(PROGRAM_ALIGNMENT - 1));
+}
+
+const uint8_t*
+Flasher_::align_next(
+    const uint8_t* address
+)
+{
+    return align_prev(address + PROGRAM_ALIGNMENT - 1);
+}
+
+const uint8_t*
+Flasher_::get_program_start()
+{
+    return reinterpret_cast<const uint8_t*>(&_memory[0]);
+}
+
+const uint8_t*
+Flasher_::get_program_end()
+{
+    return reinterpret_cast<const uint8_t*>(&_memory[CORE_FLASHER_RAM_PAGES * PAGE_WORDS]);
+}
+
+const uint8_t*
+Flasher_::get_ram_start()
+{
+    return nullptr;
+}
+
+const uint8_t*
+Flasher_::get_ram_end()
+{
+    return nullptr;
+}
+
+void
+Flasher_::jump_to(
+    const uint8_t* address
+)
+{
+    (void)address; // Nowhere to jump to
+}
+
+NAMESPACE_CORE_MW_END